@@ -0,0 +1,55 @@
+﻿#ifndef COMPACTLAYER_H
+#define COMPACTLAYER_H
+
+#include "compactpolygon.h"
+#include "layer.h"
+
+/**
+ * @brief 由 CompactPolygon 组成的紧凑层
+ *
+ * 层内所有顶点共用同一个 z 坐标. 从 Layer 构造时取第一个顶点的 z,
+ * 转换回 Layer 时各顶点的 z 均为该值.
+ */
+class SLCKIT_EXPORT CompactLayer : public QVector<CompactPolygon>
+{
+public:
+    CompactLayer ();
+    explicit CompactLayer (const Layer &layer);
+
+    const Layer toLayer () const;
+
+    void setThickness (const qreal thickness);
+    qreal thickness () const;
+
+    void setHeight (const qreal height);
+    qreal height () const;
+
+    void setZ (const qreal z);
+    qreal z () const;
+
+    quint64 vertexCount () const;
+
+    const CompactLayer translated (const Point &offset) const;
+    void translate (const Point &offset);
+
+    const Boundary boundary () const;
+    const Point center () const;
+    const Point dimension () const;
+
+    bool operator < (const CompactLayer &other) const;
+
+    qreal area () const;
+
+private:
+    qreal m_thickness = 0.0;
+    qreal m_height = 0.0;
+    qreal m_z = 0.0;
+};
+
+SLCKIT_EXPORT QDebug operator << (QDebug dbg, const CompactLayer &layer);
+SLCKIT_EXPORT QDataStream &operator << (QDataStream &stream, const CompactLayer &layer);
+SLCKIT_EXPORT QDataStream &operator >> (QDataStream &stream, CompactLayer &layer);
+
+Q_DECLARE_METATYPE (CompactLayer)
+
+#endif // COMPACTLAYER_H
@@ -0,0 +1,71 @@
+﻿#ifndef COMPACTPOLYGON_H
+#define COMPACTPOLYGON_H
+
+#include "polygon.h"
+
+/**
+ * @brief 以 float 分别存放 x, y 坐标的紧凑多边形
+ *
+ * 每个顶点占 8 字节, 而 Polygon 中的 Point 占 24 字节. z 坐标不逐点保存,
+ * 由所属的 CompactLayer 统一记录, 需要 z 的函数以参数传入.
+ */
+class SLCKIT_EXPORT CompactPolygon
+{
+public:
+    CompactPolygon ();
+    explicit CompactPolygon (const Polygon &polygon);
+
+    const Polygon toPolygon (qreal z = 0.0) const;
+
+    void setType (Polygon::PolygonType type);
+    Polygon::PolygonType type () const;
+
+    int count () const;
+    bool isEmpty () const;
+
+    void clear ();
+    void reserve (int size);
+    void resize (int size);
+
+    void append (float x, float y);
+    void append (const Point &point);
+
+    float x (int index) const;
+    float y (int index) const;
+    const Point point (int index, qreal z = 0.0) const;
+
+    float *xData ();
+    float *yData ();
+    const float *constXData () const;
+    const float *constYData () const;
+
+    void reverse ();
+
+    void close ();
+    bool isClosed () const;
+
+    const CompactPolygon translated (const Point &offset) const;
+    void translate (const Point &offset);
+
+    const Boundary boundary (qreal z = 0.0) const;
+
+    qreal area () const;
+    const Point center () const;
+    const Point dimension () const;
+
+    bool operator == (const CompactPolygon &other) const;
+    bool operator != (const CompactPolygon &other) const;
+
+private:
+    QVector<float> m_x;
+    QVector<float> m_y;
+    Polygon::PolygonType m_type = Polygon::Contour;
+};
+
+SLCKIT_EXPORT QDebug operator << (QDebug dbg, const CompactPolygon &polygon);
+SLCKIT_EXPORT QDataStream &operator << (QDataStream &stream, const CompactPolygon &polygon);
+SLCKIT_EXPORT QDataStream &operator >> (QDataStream &stream, CompactPolygon &polygon);
+
+Q_DECLARE_METATYPE (CompactPolygon)
+
+#endif // COMPACTPOLYGON_H
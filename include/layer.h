@@ -34,13 +34,34 @@ public:
         SupportContourInfill,
     };
 
+    class RefineSpec
+    {
+    public:
+        int passLimit = 50;
+        int timeLimit = 1000;
+        int segmentLength = 3;
+        int neighbourCount = 8;
+        bool twoOpt = true;
+        bool orOpt = true;
+    };
+
+    class RefineReport
+    {
+    public:
+        qreal initialDistance = 0.0;
+        qreal finalDistance = 0.0;
+        int passes = 0;
+        int moves = 0;
+    };
+
     void setThickness (const qreal thickness);
     qreal thickness () const;
 
     void setHeight (const qreal height);
     qreal height () const;
 
-    const Layer translated (const Point &offset) const;
+    Layer translated (const Point &offset) const &;
+    Layer translated (const Point &offset) &&;
     void translate (const Point &offset);
 
     const Boundary boundary () const;
@@ -52,16 +73,40 @@ public:
     bool operator < (const Layer &other) const;
 
     void sort (SortPattern pattern);
-    const Layer sorted (SortPattern pattern) const;
+    Layer sorted (SortPattern pattern) const &;
+    Layer sorted (SortPattern pattern) &&;
 
     const Point optimize (const Point &reference = Point ());
-    const Layer optimized (const Point &reference = Point ()) const;
+    Layer optimized (const Point &reference = Point ()) const &;
+    Layer optimized (const Point &reference = Point ()) &&;
 
     const Point optimize (SortPattern pattern, const Point &reference = Point ());
-    const Layer optimized (SortPattern pattern, const Point &reference = Point ()) const;
+    Layer optimized (SortPattern pattern, const Point &reference = Point ()) const &;
+    Layer optimized (SortPattern pattern, const Point &reference = Point ()) &&;
+
+    qreal travelDistance (const Point &reference = Point ()) const;
+
+    const Point refine (const Point &reference = Point ());
+    const Point refine (const Point &reference, const RefineSpec &spec, RefineReport *report = nullptr);
+
+    const Point refine (SortPattern pattern, const Point &reference = Point ());
+    const Point refine (SortPattern pattern, const Point &reference, const RefineSpec &spec, RefineReport *report = nullptr);
+
+    void offset (qreal distance, Polygon::JoinType join = Polygon::MiterJoin, qreal miterLimit = 2.0);
+    Layer offsetted (qreal distance, Polygon::JoinType join = Polygon::MiterJoin, qreal miterLimit = 2.0) const &;
+    Layer offsetted (qreal distance, Polygon::JoinType join = Polygon::MiterJoin, qreal miterLimit = 2.0) &&;
+
+    Layer united (const Layer &other) const;
+    static Layer united (const QVector<Layer> &layers);
+    Layer intersected (const Layer &other) const;
+    Layer subtracted (const Layer &other) const;
+    Layer xored (const Layer &other) const;
+
+    Layer infill (const InfillSpec &spec) const;
+    void fill (const InfillSpec &spec);
 
     void filter (Polygon::PolygonType type);
-    const Layer filtered (Polygon::PolygonType type) const;
+    Layer filtered (Polygon::PolygonType type) const;
 
     qreal area () const;
 
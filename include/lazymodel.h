@@ -0,0 +1,65 @@
+﻿#ifndef LAZYMODEL_H
+#define LAZYMODEL_H
+
+#include "model.h"
+#include "slcreader.h"
+#include <QCache>
+#include <QMutex>
+
+/**
+ * @brief 按需加载的 SLC 模型
+ *
+ * 打开文件时只建立各层高度与文件偏移的索引, 调用 at () 或 layerAtHeight ()
+ * 时才解码对应的层, 并在容量有限的 LRU 缓存中保留最近使用的层.
+ * 接口与 Model 保持一致, 层按高度排序.
+ */
+class SLCKIT_EXPORT LazyModel
+{
+public:
+    LazyModel ();
+    ~LazyModel ();
+
+    bool open (const QString &filename);
+    void close ();
+    bool isOpen () const;
+
+    int count () const;
+    bool isEmpty () const;
+
+    const Boundary boundary () const;
+    const Point center () const;
+    const Point dimension () const;
+
+    const QList <qreal> heights () const;
+    const Layer at (int index) const;
+    const Layer layerAtHeight (const qreal height,
+                               Model::HeightMatch match = Model::ExactHeight,
+                               const qreal tolerance = PREC) const;
+
+    int indexOfHeight (const qreal height,
+                       Model::HeightMatch match = Model::ExactHeight,
+                       const qreal tolerance = PREC) const;
+
+    qreal contourStartHeight () const;
+    int contourStartIndex () const;
+
+    void setCacheSize (int layerCount);
+    int cacheSize () const;
+
+    const QString name () const;
+
+private:
+    Q_DISABLE_COPY (LazyModel)
+
+    SLCReader m_reader;
+    QVector<SLCReader::LayerRecord> m_records;
+    QList<qreal> m_heights;
+    QString m_name;
+
+    mutable QMutex m_mutex;
+    mutable QCache<int, Layer> m_cache;
+    mutable Boundary m_boundary;
+    mutable bool m_boundaryValid = false;
+};
+
+#endif // LAZYMODEL_H
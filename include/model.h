@@ -2,35 +2,92 @@
 #define SLCMODEL_H
 
 #include "layer.h"
+#include <functional>
 
 class SLCKIT_EXPORT Model :public QVector<Layer>
 {
 public:
+    enum SLCReadMode
+    {
+        StreamedRead,
+        MappedRead,
+    };
+
+    enum MergeMode
+    {
+        ConcatenateContours,
+        UniteContours,
+    };
+
+    enum XLCCompression
+    {
+        NoCompression,
+        LZ4Compression,
+        ZstdCompression,
+    };
+
+    enum HeightMatch
+    {
+        ExactHeight,
+        NearestHeight,
+        FloorHeight,
+        CeilHeight,
+    };
+
     const Boundary boundary () const;
     const Point center () const;
     const Point dimension () const;
 
     const QList <qreal> heights () const;
-    const Layer at (int index) const;
-    const Layer layerAtHeight (const qreal height) const;
+    const Layer &at (int index) const;
+    const Layer &layerAtHeight (const qreal height,
+                                HeightMatch match = ExactHeight,
+                                const qreal tolerance = PREC) const;
+
+    const Layer &constAt (int index) const;
+    const Layer &constLayerAtHeight (const qreal height,
+                                     HeightMatch match = ExactHeight,
+                                     const qreal tolerance = PREC) const;
+
+    int indexOfHeight (const qreal height,
+                       HeightMatch match = ExactHeight,
+                       const qreal tolerance = PREC) const;
 
     qreal contourStartHeight () const;
     int contourStartIndex () const;
 
     void sort ();
-    void merge(const Model &other);
-    static const Model readSLC (const QString &filename);
+    void merge(const Model &other, MergeMode mode = ConcatenateContours, const qreal tolerance = PREC);
+    void merge(Model &&other, MergeMode mode = ConcatenateContours, const qreal tolerance = PREC);
+    static Model merged (QVector<Model> models, MergeMode mode = ConcatenateContours, const qreal tolerance = PREC);
+    static Model readSLC (const QString &filename, SLCReadMode mode = StreamedRead);
+    static Model readSLC (const QString &filename, int threadCount);
+    bool saveSLC (const QString &filename, Polygon::PolygonType type = Polygon::Contour) const;
 
     void translate (const Point &offset);
-    const Model translated (const Point &offset) const;
+    Model translated (const Point &offset) const &;
+    Model translated (const Point &offset) &&;
 
-    static const Model readXLC (const QString &filename);
-    bool saveXLC (const QString &filename) const;
+    const Point optimize (const Point &reference = Point (), bool chained = false, int threadCount = 0);
+    const Point optimize (Layer::SortPattern pattern, const Point &reference = Point (), bool chained = false, int threadCount = 0);
+    Model optimized (const Point &reference = Point (), bool chained = false, int threadCount = 0) const &;
+    Model optimized (const Point &reference = Point (), bool chained = false, int threadCount = 0) &&;
+    Model optimized (Layer::SortPattern pattern, const Point &reference = Point (), bool chained = false, int threadCount = 0) const &;
+    Model optimized (Layer::SortPattern pattern, const Point &reference = Point (), bool chained = false, int threadCount = 0) &&;
+
+    static Model readXLC (const QString &filename);
+    bool saveXLC (const QString &filename,
+                  XLCCompression compression = NoCompression,
+                  int threadCount = 0,
+                  const std::function<bool (int written, int count)> &progress = nullptr) const;
+    static bool isCompressionSupported (XLCCompression compression);
 
     const QString name () const;
     void setName (const QString &name);
 
 private:
+    void updateHeights ();
+
     QList<qreal> m_heights;
     QString m_name;
 };
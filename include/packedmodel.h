@@ -0,0 +1,88 @@
+﻿#ifndef PACKEDMODEL_H
+#define PACKEDMODEL_H
+
+#include "model.h"
+
+/**
+ * @brief 全部几何数据存放在一块连续内存中的模型
+ *
+ * 层表, 多边形表与顶点数组依次排列在一次分配的内存块中: 每层记录其多边形在多边形表中的区间,
+ * 每个多边形记录其顶点在顶点数组中的区间. 构造与析构各只有一次分配与释放, 没有逐个多边形的
+ * 堆分配, 也没有隐式共享的引用计数. 结构在分配时确定, 之后可以修改坐标, 层高与多边形类型,
+ * 但不能增删多边形或顶点, 需要时以 toModel () 转换为 Model.
+ */
+class SLCKIT_EXPORT PackedModel
+{
+public:
+    class LayerRange
+    {
+    public:
+        qreal height;
+        qreal thickness;
+        qint64 firstPolygon;
+        qint64 polygonCount;
+        qint64 firstVertex;
+        qint64 vertexCount;
+    };
+
+    class PolygonRange
+    {
+    public:
+        qint64 firstVertex;
+        quint32 vertexCount;
+        Polygon::PolygonType type;
+    };
+
+    PackedModel ();
+    PackedModel (int layerCount, qint64 polygonCount, qint64 vertexCount);
+    explicit PackedModel (const Model &model);
+    PackedModel (const PackedModel &other);
+    PackedModel (PackedModel &&other);
+    ~PackedModel ();
+
+    PackedModel &operator = (const PackedModel &other);
+    PackedModel &operator = (PackedModel &&other);
+
+    static PackedModel readSLC (const QString &filename, int threadCount = 0);
+    static PackedModel readXLC (const QString &filename, int threadCount = 0);
+
+    const Model toModel () const;
+    const Layer layer (int index) const;
+    const Polygon polygon (qint64 index) const;
+
+    int count () const;
+    bool isEmpty () const;
+    qint64 polygonCount () const;
+    qint64 vertexCount () const;
+    qint64 byteCount () const;
+
+    LayerRange *layerData ();
+    const LayerRange *constLayerData () const;
+    PolygonRange *polygonData ();
+    const PolygonRange *constPolygonData () const;
+    Point *pointData ();
+    const Point *constPointData () const;
+
+    void sort ();
+
+    const Boundary boundary () const;
+    const Point center () const;
+    const Point dimension () const;
+
+    void translate (const Point &offset);
+
+    const QString name () const;
+    void setName (const QString &name);
+
+private:
+    void allocate (int layerCount, qint64 polygonCount, qint64 vertexCount);
+    void release ();
+
+    char *m_arena = nullptr;
+    int m_layerCount = 0;
+    qint64 m_polygonCount = 0;
+    qint64 m_vertexCount = 0;
+    QString m_name;
+};
+
+#endif // PACKEDMODEL_H
@@ -18,22 +18,45 @@ public:
         PolygonTypeCount = Extra + 1,
     };
 
+    enum SimplifyMethod
+    {
+        DouglasPeucker,
+        Visvalingam,
+    };
+
+    enum JoinType
+    {
+        MiterJoin,
+        RoundJoin,
+        BevelJoin,
+    };
+
     void setType (PolygonType type);
     PolygonType type () const;
 
     void simplify ();
-    Polygon simplified () const;
+    Polygon simplified () const &;
+    Polygon simplified () &&;
+
+    void simplify (qreal tolerance, SimplifyMethod method = DouglasPeucker);
+    Polygon simplified (qreal tolerance, SimplifyMethod method = DouglasPeucker) const &;
+    Polygon simplified (qreal tolerance, SimplifyMethod method = DouglasPeucker) &&;
 
     void reverse ();
-    Polygon reversed () const;
+    Polygon reversed () const &;
+    Polygon reversed () &&;
 
     void close ();
-    Polygon closed () const;
+    Polygon closed () const &;
+    Polygon closed () &&;
     bool isClosed () const;
 
-    const Polygon translated (const Point &offset) const;
+    Polygon translated (const Point &offset) const &;
+    Polygon translated (const Point &offset) &&;
     void translate (const Point &offset);
 
+    QVector<Polygon> offsetted (qreal distance, JoinType join = MiterJoin, qreal miterLimit = 2.0) const;
+
     const Boundary boundary () const;
 
     qreal area () const;
@@ -0,0 +1,54 @@
+﻿#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "slckit_global.h"
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief 读写与几何处理各阶段的耗时及计数统计
+ *
+ * 只有以 CMake 选项 SLCKIT_ENABLE_PROFILING 编译本库时才会记录, 否则埋点在编译期即被去除,
+ * isEnabled () 返回 false, 各项统计均为空. 统计在进程内全局累计, 可在任意线程读取.
+ * 开启 setTracing (true) 后另行记录每一次阶段调用, 可由 saveTrace () 保存为
+ * Chrome trace event 格式的 JSON, 在 chrome://tracing 或 Perfetto 中查看.
+ */
+class SLCKIT_EXPORT Profiler
+{
+public:
+    enum Counter
+    {
+        BytesRead,
+        BytesWritten,
+        Layers,
+        Polygons,
+        Vertices,
+        Allocations,
+        CounterCount,
+    };
+
+    /**
+     * @brief 一个阶段的累计耗时, 时间单位为纳秒
+     */
+    class Stage
+    {
+    public:
+        QString name;
+        quint64 calls = 0;
+        quint64 totalTime = 0;
+        quint64 maxTime = 0;
+    };
+
+    static bool isEnabled ();
+    static void reset ();
+
+    static quint64 counter (Counter counter);
+    static const QString counterName (Counter counter);
+    static const QVector<Stage> stages ();
+
+    static void setTracing (bool enabled);
+    static bool isTracing ();
+    static bool saveTrace (const QString &filename);
+};
+
+#endif // PROFILER_H
@@ -1,7 +1,15 @@
 #include "boundary.h"
+#include "compactlayer.h"
+#include "compactpolygon.h"
 #include "layer.h"
+#include "lazymodel.h"
 #include "math.hpp"
 #include "model.h"
+#include "packedmodel.h"
 #include "point.h"
 #include "polygon.h"
+#include "profiler.h"
 #include "slckit_global.h"
+#include "slcreader.h"
+#include "slcwriter.h"
+#include "xlcreader.h"
@@ -0,0 +1,102 @@
+﻿#ifndef SLCREADER_H
+#define SLCREADER_H
+
+#include "compactlayer.h"
+#include "layer.h"
+#include "packedmodel.h"
+#include <QFile>
+#include <functional>
+
+/**
+ * @brief 基于内存映射的 SLC 文件读取器
+ *
+ * 打开时映射整个文件并一次性校验文件头 (-SLCVER, -UNIT, -TYPE),
+ * 之后各层轮廓数据直接从映射内存中解码, 不经过 QDataStream.
+ */
+class SLCKIT_EXPORT SLCReader
+{
+public:
+    class LayerRecord
+    {
+    public:
+        qint64 offset = 0;
+        qreal height = 0.0;
+        quint32 polygonCount = 0;
+        quint64 vertexCount = 0;
+    };
+
+    SLCReader ();
+    ~SLCReader ();
+
+    bool open (const QString &filename);
+    void close ();
+    bool isOpen () const;
+
+    qreal version () const;
+    qreal unitScale () const;
+    Polygon::PolygonType polygonType () const;
+
+    qint64 size () const;
+    qint64 contourOffset () const;
+
+    const QVector<LayerRecord> scan () const;
+    bool readLayer (qint64 &offset, Layer &layer) const;
+    bool readLayer (qint64 &offset, CompactLayer &layer) const;
+    bool readLayer (qint64 &offset, PackedModel &model, int index) const;
+
+private:
+    Q_DISABLE_COPY (SLCReader)
+
+    bool readHeader ();
+
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    qint64 m_contourOffset = 0;
+
+    qreal m_version = 0.0;
+    qreal m_unitScale = 1.0;
+    Polygon::PolygonType m_polygonType = Polygon::Contour;
+};
+
+/**
+ * @brief 逐层顺序读取 SLC 文件的流式读取器
+ *
+ * 每次只解码一层, 并复用调用者传入的 Layer 及其中 Polygon 的存储,
+ * 内存占用与文件大小无关. 若调用者保留了层的副本, 下一次读取时该层会自动分离.
+ */
+class SLCKIT_EXPORT SLCStreamReader
+{
+public:
+    SLCStreamReader ();
+    ~SLCStreamReader ();
+
+    bool open (const QString &filename);
+    void close ();
+    bool isOpen () const;
+    bool atEnd () const;
+
+    qreal version () const;
+    qreal unitScale () const;
+    Polygon::PolygonType polygonType () const;
+
+    bool readNext (Layer &layer);
+    int forEachLayer (const std::function<bool (const Layer &layer)> &callback);
+
+private:
+    Q_DISABLE_COPY (SLCStreamReader)
+
+    bool readRaw (char *data, qint64 size);
+
+    QFile m_file;
+    qint64 m_size = 0;
+    QByteArray m_buffer;
+    Layer m_layer;
+    bool m_atEnd = true;
+
+    qreal m_version = 0.0;
+    qreal m_unitScale = 1.0;
+    Polygon::PolygonType m_polygonType = Polygon::Contour;
+};
+
+#endif // SLCREADER_H
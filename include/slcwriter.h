@@ -0,0 +1,55 @@
+﻿#ifndef SLCWRITER_H
+#define SLCWRITER_H
+
+#include "compactlayer.h"
+#include "layer.h"
+#include <QFile>
+
+/**
+ * @brief 逐层写出 SLC 2.0 文件的流式写入器
+ *
+ * open () 写出文件头, 保留段与只含一项的采样表, 之后每次 writeLayer () 追加一个轮廓记录,
+ * close () 写出结束标记. 顶点以 float 编码到缓冲区中, 攒满后整块写出,
+ * 内存占用与文件大小无关. 多边形按原样写出, 不会自动闭合.
+ */
+class SLCKIT_EXPORT SLCWriter
+{
+public:
+    class Header
+    {
+    public:
+        Polygon::PolygonType type = Polygon::Contour;
+        qreal minZ = 0.0;
+        qreal thickness = 0.0;
+        qreal lineWidthCompensation = 0.0;
+        Boundary extents;
+    };
+
+    SLCWriter ();
+    ~SLCWriter ();
+
+    bool open (const QString &filename);
+    bool open (const QString &filename, const Header &header);
+    bool close ();
+    bool isOpen () const;
+
+    bool writeLayer (const Layer &layer);
+    bool writeLayer (const CompactLayer &layer);
+
+    int layerCount () const;
+
+private:
+    Q_DISABLE_COPY (SLCWriter)
+
+    bool flush ();
+    uchar *reserve (qint64 size);
+
+    QFile m_file;
+    QByteArray m_buffer;
+    qint64 m_used = 0;
+    bool m_ok = false;
+    int m_layerCount = 0;
+    float m_lastZ = 0.0f;
+};
+
+#endif // SLCWRITER_H
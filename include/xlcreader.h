@@ -0,0 +1,66 @@
+﻿#ifndef XLCREADER_H
+#define XLCREADER_H
+
+#include "compactlayer.h"
+#include "layer.h"
+#include "model.h"
+#include "packedmodel.h"
+#include <QFile>
+
+/**
+ * @brief 基于内存映射的 XLC v3 文件读取器
+ *
+ * 打开时校验文件头并读入层目录, 之后任一层都可按目录直接定位解码,
+ * 不必顺序读过前面的层. 未压缩的文件中各层坐标以 float 连续存放, 可整块复制;
+ * 压缩的文件逐层解压, 不同的层可在不同线程中同时读取.
+ */
+class SLCKIT_EXPORT XLCReader
+{
+public:
+    class LayerRecord
+    {
+    public:
+        qreal height = 0.0;
+        qreal thickness = 0.0;
+        qreal z = 0.0;
+        qint64 offset = 0;
+        qint64 length = 0;
+        quint32 polygonCount = 0;
+        quint32 vertexCount = 0;
+        Boundary boundary;
+    };
+
+    XLCReader ();
+    ~XLCReader ();
+
+    bool open (const QString &filename);
+    void close ();
+    bool isOpen () const;
+
+    const QString name () const;
+    Model::XLCCompression compression () const;
+
+    int count () const;
+    const QVector<LayerRecord> records () const;
+    const LayerRecord record (int index) const;
+
+    bool readLayer (int index, Layer &layer) const;
+    bool readLayer (int index, CompactLayer &layer) const;
+    bool readLayer (int index, PackedModel &model) const;
+
+private:
+    Q_DISABLE_COPY (XLCReader)
+
+    bool readHeader ();
+    const uchar *block (int index, QByteArray &buffer) const;
+
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+
+    QString m_name;
+    quint32 m_compression = Model::NoCompression;
+    QVector<LayerRecord> m_records;
+};
+
+#endif // XLCREADER_H
@@ -0,0 +1,158 @@
+﻿#include "compactlayer.h"
+
+CompactLayer::CompactLayer ()
+{}
+
+CompactLayer::CompactLayer (const Layer &layer) :
+    m_thickness (layer.thickness ()),
+    m_height (layer.height ())
+{
+    bool hasZ (false);
+    reserve (layer.count ());
+    for (const Polygon &polygon : layer)
+    {
+        if (! hasZ && ! polygon.isEmpty ())
+        {
+            m_z = polygon.first ().z ();
+            hasZ = true;
+        }
+        append (CompactPolygon (polygon));
+    }
+}
+
+const Layer CompactLayer::toLayer () const
+{
+    Layer layer;
+    layer.setThickness (m_thickness);
+    layer.setHeight (m_height);
+    layer.reserve (count ());
+    for (const CompactPolygon &polygon : *this)
+    {
+        layer.append (polygon.toPolygon (m_z));
+    }
+    return layer;
+}
+
+void CompactLayer::setThickness (const qreal thickness)
+{
+    m_thickness = thickness;
+}
+
+qreal CompactLayer::thickness () const
+{
+    return m_thickness;
+}
+
+void CompactLayer::setHeight (const qreal height)
+{
+    m_height = height;
+}
+
+qreal CompactLayer::height () const
+{
+    return m_height;
+}
+
+void CompactLayer::setZ (const qreal z)
+{
+    m_z = z;
+}
+
+qreal CompactLayer::z () const
+{
+    return m_z;
+}
+
+quint64 CompactLayer::vertexCount () const
+{
+    quint64 vertexCount (0);
+    for (const CompactPolygon &polygon : *this)
+    {
+        vertexCount += polygon.count ();
+    }
+    return vertexCount;
+}
+
+const CompactLayer CompactLayer::translated (const Point &offset) const
+{
+    CompactLayer other (*this);
+    other.translate (offset);
+    return other;
+}
+
+void CompactLayer::translate (const Point &offset)
+{
+    if (! offset.isValid ())
+    {
+        return;
+    }
+
+    for (CompactPolygon &polygon : *this)
+    {
+        polygon.translate (offset);
+    }
+    m_z += offset.z ();
+}
+
+const Boundary CompactLayer::boundary () const
+{
+    Boundary boundary;
+    for (const CompactPolygon &polygon : *this)
+    {
+        boundary.refer (polygon.boundary (m_z));
+    }
+    return boundary;
+}
+
+const Point CompactLayer::center () const
+{
+    return boundary ().center ();
+}
+
+const Point CompactLayer::dimension () const
+{
+    return boundary ().dimension ();
+}
+
+bool CompactLayer::operator < (const CompactLayer &other) const
+{
+    return (m_height < other.m_height);
+}
+
+qreal CompactLayer::area () const
+{
+    qreal area (0.0);
+    for (const CompactPolygon &polygon : *this)
+    {
+        area += polygon.area ();
+    }
+    return area;
+}
+
+QDebug operator << (QDebug dbg, const CompactLayer &layer)
+{
+    dbg << layer.toLayer ();
+    return dbg;
+}
+
+QDataStream &operator >> (QDataStream &stream, CompactLayer &layer)
+{
+    qreal thickness, height, z;
+    stream >> thickness;
+    stream >> height;
+    stream >> z;
+    stream >> *((QVector<CompactPolygon>*)&layer);
+    layer.setThickness (thickness);
+    layer.setHeight (height);
+    layer.setZ (z);
+    return stream;
+}
+
+QDataStream &operator << (QDataStream &stream, const CompactLayer &layer)
+{
+    stream << layer.thickness ();
+    stream << layer.height ();
+    stream << layer.z ();
+    stream << *((QVector<CompactPolygon>*)&layer);
+    return stream;
+}
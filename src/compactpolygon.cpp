@@ -0,0 +1,300 @@
+﻿#include "compactpolygon.h"
+#include <algorithm>
+
+CompactPolygon::CompactPolygon ()
+{}
+
+CompactPolygon::CompactPolygon (const Polygon &polygon) :
+    m_type (polygon.type ())
+{
+    resize (polygon.count ());
+    float *x (m_x.data ());
+    float *y (m_y.data ());
+    for (const Point &point : polygon)
+    {
+        *x++ = float (point.x ());
+        *y++ = float (point.y ());
+    }
+}
+
+const Polygon CompactPolygon::toPolygon (qreal z) const
+{
+    Polygon polygon;
+    polygon.setType (m_type);
+    polygon.resize (count ());
+
+    Point *point (polygon.data ());
+    for (int i = 0; i < count (); ++i)
+    {
+        point [i].setValue (m_x.at (i), m_y.at (i), z);
+    }
+    return polygon;
+}
+
+void CompactPolygon::setType (Polygon::PolygonType type)
+{
+    m_type = type;
+}
+
+Polygon::PolygonType CompactPolygon::type () const
+{
+    return m_type;
+}
+
+int CompactPolygon::count () const
+{
+    return m_x.count ();
+}
+
+bool CompactPolygon::isEmpty () const
+{
+    return m_x.isEmpty ();
+}
+
+void CompactPolygon::clear ()
+{
+    m_x.clear ();
+    m_y.clear ();
+}
+
+void CompactPolygon::reserve (int size)
+{
+    m_x.reserve (size);
+    m_y.reserve (size);
+}
+
+void CompactPolygon::resize (int size)
+{
+    m_x.resize (size);
+    m_y.resize (size);
+}
+
+void CompactPolygon::append (float x, float y)
+{
+    m_x.append (x);
+    m_y.append (y);
+}
+
+void CompactPolygon::append (const Point &point)
+{
+    append (float (point.x ()), float (point.y ()));
+}
+
+float CompactPolygon::x (int index) const
+{
+    return m_x.at (index);
+}
+
+float CompactPolygon::y (int index) const
+{
+    return m_y.at (index);
+}
+
+const Point CompactPolygon::point (int index, qreal z) const
+{
+    return Point (m_x.at (index), m_y.at (index), z);
+}
+
+float *CompactPolygon::xData ()
+{
+    return m_x.data ();
+}
+
+float *CompactPolygon::yData ()
+{
+    return m_y.data ();
+}
+
+const float *CompactPolygon::constXData () const
+{
+    return m_x.constData ();
+}
+
+const float *CompactPolygon::constYData () const
+{
+    return m_y.constData ();
+}
+
+void CompactPolygon::reverse ()
+{
+    std::reverse (m_x.begin (), m_x.end ());
+    std::reverse (m_y.begin (), m_y.end ());
+}
+
+void CompactPolygon::close ()
+{
+    if (! isClosed ())
+    {
+        append (m_x.first (), m_y.first ());
+    }
+}
+
+bool CompactPolygon::isClosed () const
+{
+    // 空路径亦是闭合的, 与 Polygon::isClosed 一致
+    bool isClosed (true);
+    if (! isEmpty ())
+        isClosed = (point (0) == point (count () - 1));
+    return isClosed;
+}
+
+const CompactPolygon CompactPolygon::translated (const Point &offset) const
+{
+    CompactPolygon other (*this);
+    other.translate (offset);
+    return other;
+}
+
+/**
+ * @brief 平移多边形, offset 的 z 分量由 CompactLayer::translate 处理
+ */
+void CompactPolygon::translate (const Point &offset)
+{
+    if (! offset.isValid ())
+    {
+        return;
+    }
+
+    const float dx (float (offset.x ()));
+    const float dy (float (offset.y ()));
+    float *x (m_x.data ());
+    float *y (m_y.data ());
+    for (int i = 0; i < count (); ++i)
+    {
+        x [i] += dx;
+        y [i] += dy;
+    }
+}
+
+const Boundary CompactPolygon::boundary (qreal z) const
+{
+    Boundary boundary;
+    if (isEmpty ())
+    {
+        return boundary;
+    }
+
+    const float *x (m_x.constData ());
+    const float *y (m_y.constData ());
+    float minX (x [0]), maxX (x [0]);
+    float minY (y [0]), maxY (y [0]);
+    for (int i = 1; i < count (); ++i)
+    {
+        minX = std::min (minX, x [i]);
+        maxX = std::max (maxX, x [i]);
+        minY = std::min (minY, y [i]);
+        maxY = std::max (maxY, y [i]);
+    }
+
+    boundary.setMinX (minX);
+    boundary.setMaxX (maxX);
+    boundary.setMinY (minY);
+    boundary.setMaxY (maxY);
+    boundary.setMinZ (z);
+    boundary.setMaxZ (z);
+    return boundary;
+}
+
+/**
+ * @brief 与 Polygon::area 相同的算法, 在 qreal 精度下累加
+ */
+qreal CompactPolygon::area () const
+{
+    qreal area (0.0);
+    int N (count ());
+
+    if (N < 3)
+    {
+        return area;
+    }
+
+    const float *x (m_x.constData ());
+    const float *y (m_y.constData ());
+    for (int i = 0; i < N - 1; ++i)
+    {
+        area += qreal (x [i]) * y [i + 1] - qreal (x [i + 1]) * y [i];
+    }
+
+    area /= 2.0;
+
+    return area;
+}
+
+const Point CompactPolygon::center () const
+{
+    return boundary ().center ();
+}
+
+const Point CompactPolygon::dimension () const
+{
+    return boundary ().dimension ();
+}
+
+bool CompactPolygon::operator == (const CompactPolygon &other) const
+{
+    return (m_type == other.m_type && m_x == other.m_x && m_y == other.m_y);
+}
+
+bool CompactPolygon::operator != (const CompactPolygon &other) const
+{
+    return ! operator == (other);
+}
+
+QDebug operator << (QDebug dbg, const CompactPolygon &polygon)
+{
+    dbg << polygon.toPolygon ();
+    return dbg;
+}
+
+// coordinates are always written in single precision, whatever the stream's
+// floatingPointPrecision is, so that the stored form stays compact too
+QDataStream &operator << (QDataStream &stream, const CompactPolygon &polygon)
+{
+    QDataStream::FloatingPointPrecision precision (stream.floatingPointPrecision ());
+    stream.setFloatingPointPrecision (QDataStream::SinglePrecision);
+
+    stream << polygon.type ();
+    stream << quint32 (polygon.count ());
+    for (int i = 0; i < polygon.count (); ++i)
+    {
+        stream << polygon.x (i);
+    }
+    for (int i = 0; i < polygon.count (); ++i)
+    {
+        stream << polygon.y (i);
+    }
+
+    stream.setFloatingPointPrecision (precision);
+    return stream;
+}
+
+QDataStream &operator >> (QDataStream &stream, CompactPolygon &polygon)
+{
+    QDataStream::FloatingPointPrecision precision (stream.floatingPointPrecision ());
+    stream.setFloatingPointPrecision (QDataStream::SinglePrecision);
+
+    int type (0);
+    quint32 count (0);
+    stream >> type;
+    stream >> count;
+
+    polygon.clear ();
+    polygon.setType ((Polygon::PolygonType)type);
+    if (stream.status () == QDataStream::Ok)
+    {
+        polygon.resize (int (count));
+        float *x (polygon.xData ());
+        float *y (polygon.yData ());
+        for (quint32 i = 0; i < count; ++i)
+        {
+            stream >> x [i];
+        }
+        for (quint32 i = 0; i < count; ++i)
+        {
+            stream >> y [i];
+        }
+    }
+
+    stream.setFloatingPointPrecision (precision);
+    return stream;
+}
@@ -0,0 +1,283 @@
+﻿#include "endpointindex.h"
+#include <algorithm>
+
+/**
+ * @brief 为 polygons 中所有非空多边形的首末端点建立索引
+ */
+EndpointIndex::EndpointIndex (const Polygon *polygons, int count) :
+    m_first (count, -1),
+    m_last (count, -1)
+{
+    m_endpoints.reserve (count * 2);
+    for (int i = 0; i < count; ++i)
+    {
+        const Polygon &polygon (polygons [i]);
+        if (polygon.isEmpty ())
+        {
+            continue;
+        }
+
+        const Point &first (polygon.first ());
+        const Point &last (polygon.last ());
+        m_endpoints.append (Endpoint {first.x (), first.y (), i, false});
+        m_endpoints.append (Endpoint {last.x (), last.y (), i, true});
+    }
+
+    m_alive.resize (m_endpoints.count ());
+    m_removed.fill (false, m_endpoints.count ());
+    build (0, m_endpoints.count (), 0);
+
+    for (int position = 0; position < m_endpoints.count (); ++position)
+    {
+        const Endpoint &endpoint (m_endpoints.at (position));
+        if (endpoint.last)
+        {
+            m_last [endpoint.polygon] = position;
+        }
+        else
+        {
+            m_first [endpoint.polygon] = position;
+        }
+    }
+}
+
+bool EndpointIndex::isEmpty () const
+{
+    return (m_endpoints.isEmpty () || m_alive.at ((m_endpoints.count ()) / 2) == 0);
+}
+
+/**
+ * @brief 查找距 point 最近的未删除端点
+ *
+ * 距离相同时优先取首端点, 再优先取原始下标较小的多边形. 旧的 Layer::optimize 按多边形在交换过程中
+ * 的当前位置取舍, 因此对称或重复的轮廓等距离相同的情况下, 访问顺序可能与旧实现不同.
+ * @param polygon 返回端点所属多边形的下标
+ * @param last 返回该端点是否为多边形的末端点
+ * @return 索引中已无端点时返回 false
+ */
+bool EndpointIndex::nearest (const Point &point, int &polygon, bool &last) const
+{
+    if (isEmpty ())
+    {
+        return false;
+    }
+
+    int best (-1);
+    qreal bestDistance2 (INFINITY);
+    nearest (0, m_endpoints.count (), 0, point.x (), point.y (), best, bestDistance2);
+
+    if (best < 0)
+    {
+        return false;
+    }
+
+    polygon = m_endpoints.at (best).polygon;
+    last = m_endpoints.at (best).last;
+    return true;
+}
+
+/**
+ * @brief 查找端点距 point 最近的 count 个未删除多边形
+ * @param polygons 返回多边形下标, 按距离由近到远排列, 索引中不足 count 个时全部返回
+ */
+void EndpointIndex::neighbours (const Point &point, int count, QVector<int> &polygons) const
+{
+    polygons.clear ();
+    if (isEmpty () || count <= 0)
+    {
+        return;
+    }
+
+    // a polygon owns two endpoints, so the 2 * count nearest ones cover at least count polygons
+    QVector<QPair<qreal, int> > heap;
+    heap.reserve (count * 2);
+    neighbours (0, m_endpoints.count (), 0, point.x (), point.y (), count * 2, heap);
+    std::sort_heap (heap.begin (), heap.end ());
+
+    for (const QPair<qreal, int> &entry : heap)
+    {
+        const int polygon (m_endpoints.at (entry.second).polygon);
+        if (! polygons.contains (polygon))
+        {
+            polygons.append (polygon);
+            if (polygons.count () == count)
+            {
+                break;
+            }
+        }
+    }
+}
+
+void EndpointIndex::remove (int polygon)
+{
+    if (m_first.at (polygon) >= 0 && ! m_removed.at (m_first.at (polygon)))
+    {
+        removeAt (m_first.at (polygon));
+        removeAt (m_last.at (polygon));
+    }
+}
+
+// the tree is implicit: the node of range [lower, upper) is the median at (lower + upper) / 2,
+// split on x at even depths and on y at odd depths
+void EndpointIndex::build (int lower, int upper, int depth)
+{
+    if (lower >= upper)
+    {
+        return;
+    }
+
+    const int middle ((lower + upper) / 2);
+    const bool splitX (depth % 2 == 0);
+    std::nth_element (m_endpoints.begin () + lower,
+                      m_endpoints.begin () + middle,
+                      m_endpoints.begin () + upper,
+                      [splitX] (const Endpoint &a, const Endpoint &b)
+                      {
+                          return splitX ? (a.x < b.x) : (a.y < b.y);
+                      });
+    m_alive [middle] = upper - lower;
+
+    build (lower, middle, depth + 1);
+    build (middle + 1, upper, depth + 1);
+}
+
+bool EndpointIndex::isBetter (int position, qreal distance2, int best, qreal bestDistance2) const
+{
+    if (best < 0 || distance2 < bestDistance2)
+    {
+        return true;
+    }
+    if (distance2 > bestDistance2)
+    {
+        return false;
+    }
+
+    const Endpoint &candidate (m_endpoints.at (position));
+    const Endpoint &current (m_endpoints.at (best));
+    if (candidate.last != current.last)
+    {
+        return ! candidate.last;
+    }
+    return (candidate.polygon < current.polygon);
+}
+
+void EndpointIndex::nearest (int lower, int upper, int depth, qreal x, qreal y, int &best, qreal &bestDistance2) const
+{
+    if (lower >= upper)
+    {
+        return;
+    }
+
+    const int middle ((lower + upper) / 2);
+    if (m_alive.at (middle) == 0)
+    {
+        return;
+    }
+
+    const Endpoint &endpoint (m_endpoints.at (middle));
+    if (! m_removed.at (middle))
+    {
+        const qreal dx (endpoint.x - x);
+        const qreal dy (endpoint.y - y);
+        const qreal distance2 (dx * dx + dy * dy);
+        if (isBetter (middle, distance2, best, bestDistance2))
+        {
+            best = middle;
+            bestDistance2 = distance2;
+        }
+    }
+
+    const qreal delta ((depth % 2 == 0) ? (x - endpoint.x) : (y - endpoint.y));
+    if (delta < 0.0)
+    {
+        nearest (lower, middle, depth + 1, x, y, best, bestDistance2);
+        if (delta * delta <= bestDistance2)
+        {
+            nearest (middle + 1, upper, depth + 1, x, y, best, bestDistance2);
+        }
+    }
+    else
+    {
+        nearest (middle + 1, upper, depth + 1, x, y, best, bestDistance2);
+        if (delta * delta <= bestDistance2)
+        {
+            nearest (lower, middle, depth + 1, x, y, best, bestDistance2);
+        }
+    }
+}
+
+// heap is a max-heap on the squared distance holding at most count endpoint positions
+void EndpointIndex::neighbours (int lower, int upper, int depth, qreal x, qreal y, int count, QVector<QPair<qreal, int> > &heap) const
+{
+    if (lower >= upper)
+    {
+        return;
+    }
+
+    const int middle ((lower + upper) / 2);
+    if (m_alive.at (middle) == 0)
+    {
+        return;
+    }
+
+    const Endpoint &endpoint (m_endpoints.at (middle));
+    if (! m_removed.at (middle))
+    {
+        const qreal dx (endpoint.x - x);
+        const qreal dy (endpoint.y - y);
+        const qreal distance2 (dx * dx + dy * dy);
+        if (heap.count () < count)
+        {
+            heap.append (qMakePair (distance2, middle));
+            std::push_heap (heap.begin (), heap.end ());
+        }
+        else if (distance2 < heap.first ().first)
+        {
+            std::pop_heap (heap.begin (), heap.end ());
+            heap.last () = qMakePair (distance2, middle);
+            std::push_heap (heap.begin (), heap.end ());
+        }
+    }
+
+    const qreal delta ((depth % 2 == 0) ? (x - endpoint.x) : (y - endpoint.y));
+    if (delta < 0.0)
+    {
+        neighbours (lower, middle, depth + 1, x, y, count, heap);
+        if (heap.count () < count || delta * delta <= heap.first ().first)
+        {
+            neighbours (middle + 1, upper, depth + 1, x, y, count, heap);
+        }
+    }
+    else
+    {
+        neighbours (middle + 1, upper, depth + 1, x, y, count, heap);
+        if (heap.count () < count || delta * delta <= heap.first ().first)
+        {
+            neighbours (lower, middle, depth + 1, x, y, count, heap);
+        }
+    }
+}
+
+void EndpointIndex::removeAt (int position)
+{
+    int lower (0);
+    int upper (m_endpoints.count ());
+    while (lower < upper)
+    {
+        const int middle ((lower + upper) / 2);
+        --m_alive [middle];
+        if (position == middle)
+        {
+            break;
+        }
+        else if (position < middle)
+        {
+            upper = middle;
+        }
+        else
+        {
+            lower = middle + 1;
+        }
+    }
+    m_removed [position] = true;
+}
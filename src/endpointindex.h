@@ -0,0 +1,47 @@
+﻿#ifndef ENDPOINTINDEX_H
+#define ENDPOINTINDEX_H
+
+#include "polygon.h"
+#include <QPair>
+
+/**
+ * @brief 多边形首末端点的二维 k-d 树, 用于行程优化中的最近邻查询
+ *
+ * 树在构造时一次建成, 每个节点记录其子树中未删除的端点数,
+ * 删除多边形只需沿根到节点的路径更新计数, 查询时跳过已空的子树.
+ */
+class EndpointIndex
+{
+public:
+    class Endpoint
+    {
+    public:
+        qreal x;
+        qreal y;
+        int polygon;
+        bool last;
+    };
+
+    EndpointIndex (const Polygon *polygons, int count);
+
+    bool isEmpty () const;
+
+    bool nearest (const Point &point, int &polygon, bool &last) const;
+    void neighbours (const Point &point, int count, QVector<int> &polygons) const;
+    void remove (int polygon);
+
+private:
+    void build (int lower, int upper, int depth);
+    void nearest (int lower, int upper, int depth, qreal x, qreal y, int &best, qreal &bestDistance2) const;
+    void neighbours (int lower, int upper, int depth, qreal x, qreal y, int count, QVector<QPair<qreal, int> > &heap) const;
+    void removeAt (int position);
+    bool isBetter (int position, qreal distance2, int best, qreal bestDistance2) const;
+
+    QVector<Endpoint> m_endpoints;
+    QVector<int> m_alive;
+    QVector<bool> m_removed;
+    QVector<int> m_first;
+    QVector<int> m_last;
+};
+
+#endif // ENDPOINTINDEX_H
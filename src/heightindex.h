@@ -0,0 +1,80 @@
+﻿#ifndef HEIGHTINDEX_H
+#define HEIGHTINDEX_H
+
+#include "model.h"
+#include <algorithm>
+
+/**
+ * @brief 在升序排列的高度表中二分查找指定高度
+ *
+ * 若有多个相同高度, 总是返回其中第一个的下标, 与 QList::indexOf 一致.
+ * @param heights 升序排列的高度表, 即 Model::sort 之后的 heights ()
+ * @param match 匹配方式 @see Model::HeightMatch
+ * @param tolerance 高度比较精度, 三种方式都包含高度差恰为 tolerance 的层, 为 0 时要求高度相等
+ * @return 匹配的下标, 无匹配时返回 -1
+ */
+static inline int searchHeight (const QList<qreal> &heights,
+                                const qreal height,
+                                Model::HeightMatch match,
+                                const qreal tolerance)
+{
+    if (heights.isEmpty () || std::isnan (height))
+    {
+        return -1;
+    }
+
+    QList<qreal>::const_iterator begin (heights.cbegin ());
+    QList<qreal>::const_iterator end (heights.cend ());
+    int index (-1);
+
+    switch (match)
+    {
+    case Model::ExactHeight:
+    case Model::NearestHeight:
+        {
+            int upper (std::lower_bound (begin, end, height) - begin);
+            int lower (upper - 1);
+
+            if (upper >= heights.count ())
+            {
+                index = lower;
+            }
+            else if (lower < 0)
+            {
+                index = upper;
+            }
+            else
+            {
+                index = (height - heights.at (lower) <= heights.at (upper) - height) ? lower : upper;
+            }
+
+            // the edge counts as a match, as in the floor and ceil bounds below
+            if (match == Model::ExactHeight && std::abs (heights.at (index) - height) > tolerance)
+            {
+                index = -1;
+            }
+        }
+        break;
+
+    case Model::FloorHeight:
+        index = int (std::upper_bound (begin, end, height + tolerance) - begin) - 1;
+        break;
+
+    case Model::CeilHeight:
+        index = int (std::lower_bound (begin, end, height - tolerance) - begin);
+        if (index >= heights.count ())
+        {
+            index = -1;
+        }
+        break;
+    }
+
+    // first of the layers sharing this height
+    if (index > 0)
+    {
+        index = int (std::lower_bound (begin, begin + index, heights.at (index)) - begin);
+    }
+    return index;
+}
+
+#endif // HEIGHTINDEX_H
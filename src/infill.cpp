@@ -0,0 +1,475 @@
+﻿#include "infill.h"
+#include "planar.h"
+#include <algorithm>
+
+// All work is done in a frame rotated by -spec.angle, where the hatch lines
+// are horizontal. Every non-horizontal contour edge goes into an edge table
+// sorted by its lower y; sweeping the scanlines upwards, edges enter the
+// active list when the scanline reaches their lower end and leave it at their
+// upper end (half-open, so a vertex on a scanline is counted once). The
+// crossings of the active edges, sorted by x, pair up into inside spans by
+// the even-odd rule.
+
+namespace
+{
+
+class Vertex
+{
+public:
+    qreal x;
+    qreal y;
+};
+
+class Edge
+{
+public:
+    qreal lowerY;
+    qreal upperY;
+    qreal lowerX;
+    qreal slope;
+    int ring;
+    int index;
+};
+
+class Crossing
+{
+public:
+    qreal x;
+    int edge;
+
+    bool operator < (const Crossing &other) const
+    {
+        return (x < other.x || (x == other.x && edge < other.edge));
+    }
+};
+
+class Hatcher
+{
+public:
+    Hatcher (const Layer &layer, const Layer::InfillSpec &spec);
+
+    void run (Layer &output);
+
+private:
+    void scan (int line, QVector<Crossing> &crossings);
+
+    const Point toPoint (qreal x, qreal y) const;
+    qreal crossingX (int edge, qreal y) const;
+    bool isCrossing (int edge, qreal y) const;
+    bool follow (int edge, int line, QVector<Point> &path, int &next) const;
+
+    void emitSegments (const QVector<Crossing> &crossings, int line, bool alternate, Layer &output) const;
+
+    Layer::InfillSpec m_spec;
+    qreal m_cos = 1.0;
+    qreal m_sin = 0.0;
+    qreal m_z = 0.0;
+
+    QVector<QVector<Vertex> > m_rings;
+    QVector<int> m_ringEdges;
+    QVector<Edge> m_edges;
+    QVector<int> m_table;
+    int m_tableIndex = 0;
+    QVector<int> m_active;
+
+    qreal m_lowerY = INFINITY;
+    qreal m_upperY = -INFINITY;
+};
+
+Hatcher::Hatcher (const Layer &layer, const Layer::InfillSpec &spec) :
+    m_spec (spec)
+{
+    const qreal angle (spec.angle * PI / 180.0);
+    m_cos = std::cos (angle);
+    m_sin = std::sin (angle);
+
+    bool first (true);
+    for (const Polygon &polygon : layer)
+    {
+        if (polygon.type () != Polygon::Contour || polygon.count () < 3)
+        {
+            continue;
+        }
+        if (first)
+        {
+            m_z = polygon.first ().z ();
+            first = false;
+        }
+
+        QVector<Vertex> ring;
+        ring.reserve (polygon.count ());
+        for (const Point &point : polygon)
+        {
+            const Vertex vertex {point.x () * m_cos + point.y () * m_sin, point.y () * m_cos - point.x () * m_sin};
+            if (ring.isEmpty () || ring.last ().x != vertex.x || ring.last ().y != vertex.y)
+            {
+                ring.append (vertex);
+            }
+        }
+        while (ring.count () > 1 && ring.first ().x == ring.last ().x && ring.first ().y == ring.last ().y)
+        {
+            ring.removeLast ();
+        }
+        if (ring.count () < 3)
+        {
+            continue;
+        }
+
+        const int r (m_rings.count ());
+        m_ringEdges.append (m_edges.count ());
+        for (int i = 0; i < ring.count (); ++i)
+        {
+            const Vertex &a (ring.at (i));
+            const Vertex &b (ring.at ((i + 1) % ring.count ()));
+            const Vertex &lower (a.y < b.y ? a : b);
+            const Vertex &upper (a.y < b.y ? b : a);
+            const qreal height (upper.y - lower.y);
+            m_edges.append (Edge {lower.y, upper.y, lower.x, height > 0.0 ? (upper.x - lower.x) / height : 0.0, r, i});
+            m_lowerY = std::min (m_lowerY, lower.y);
+            m_upperY = std::max (m_upperY, upper.y);
+        }
+        m_rings.append (ring);
+    }
+
+    m_table.reserve (m_edges.count ());
+    for (int e = 0; e < m_edges.count (); ++e)
+    {
+        if (m_edges.at (e).upperY > m_edges.at (e).lowerY)
+        {
+            m_table.append (e);
+        }
+    }
+    std::sort (m_table.begin (), m_table.end (), [this] (int a, int b)
+    {
+        return (m_edges.at (a).lowerY < m_edges.at (b).lowerY);
+    });
+}
+
+const Point Hatcher::toPoint (qreal x, qreal y) const
+{
+    return Point (x * m_cos - y * m_sin, x * m_sin + y * m_cos, m_z);
+}
+
+qreal Hatcher::crossingX (int edge, qreal y) const
+{
+    const Edge &e (m_edges.at (edge));
+    return e.lowerX + (y - e.lowerY) * e.slope;
+}
+
+bool Hatcher::isCrossing (int edge, qreal y) const
+{
+    const Edge &e (m_edges.at (edge));
+    return (e.lowerY <= y && y < e.upperY);
+}
+
+/**
+ * @brief 求第 line 条扫描线与区域边界的交点, 按 x 升序排列
+ */
+void Hatcher::scan (int line, QVector<Crossing> &crossings)
+{
+    const qreal y (line * m_spec.interval);
+
+    while (m_tableIndex < m_table.count () && m_edges.at (m_table.at (m_tableIndex)).lowerY <= y)
+    {
+        m_active.append (m_table.at (m_tableIndex++));
+    }
+
+    crossings.clear ();
+    int alive (0);
+    for (int i = 0; i < m_active.count (); ++i)
+    {
+        const int edge (m_active.at (i));
+        if (m_edges.at (edge).upperY <= y)
+        {
+            continue;
+        }
+        m_active [alive++] = edge;
+        crossings.append (Crossing {crossingX (edge, y), edge});
+    }
+    m_active.resize (alive);
+
+    std::sort (crossings.begin (), crossings.end ());
+    if (crossings.count () % 2 != 0)
+    {
+        crossings.removeLast ();
+    }
+}
+
+/**
+ * @brief 沿边界从第 line 条扫描线上的 edge 走到第 line + 1 条扫描线
+ *
+ * 只要边界在两条扫描线之间没有折回第 line 条扫描线, 路径就贴着边界, 可以作为相邻填充线的连接.
+ * @param path 返回途经的顶点, 不含两端的交点
+ * @param next 返回到达第 line + 1 条扫描线时所在的边
+ * @return 能够到达时返回 true
+ */
+bool Hatcher::follow (int edge, int line, QVector<Point> &path, int &next) const
+{
+    const qreal y0 (line * m_spec.interval);
+    const qreal y1 ((line + 1) * m_spec.interval);
+
+    path.clear ();
+    if (isCrossing (edge, y1))
+    {
+        next = edge;
+        return true;
+    }
+
+    const Edge &e (m_edges.at (edge));
+    const QVector<Vertex> &ring (m_rings.at (e.ring));
+    const int count (ring.count ());
+    const int base (m_ringEdges.at (e.ring));
+
+    // edge i joins vertex i and vertex i + 1, walk on from its upper end
+    const bool forward (ring.at ((e.index + 1) % count).y > ring.at (e.index).y);
+    int vertex (forward ? (e.index + 1) % count : e.index);
+    for (int step = 0; step < count; ++step)
+    {
+        path.append (toPoint (ring.at (vertex).x, ring.at (vertex).y));
+
+        const int index (forward ? vertex : (vertex + count - 1) % count);
+        const int candidate (base + index);
+        if (isCrossing (candidate, y1))
+        {
+            next = candidate;
+            return true;
+        }
+        if (isCrossing (candidate, y0))
+        {
+            return false;
+        }
+        vertex = forward ? (vertex + 1) % count : (vertex + count - 1) % count;
+    }
+    return false;
+}
+
+void Hatcher::emitSegments (const QVector<Crossing> &crossings, int line, bool alternate, Layer &output) const
+{
+    const qreal y (line * m_spec.interval);
+    const bool reversed (alternate && (line % 2 != 0));
+    for (int i = 0; i + 1 < crossings.count (); i += 2)
+    {
+        Polygon polygon;
+        polygon.setType (Polygon::Infill);
+        polygon.append (toPoint (crossings.at (reversed ? i + 1 : i).x, y));
+        polygon.append (toPoint (crossings.at (reversed ? i : i + 1).x, y));
+        output.append (polygon);
+    }
+}
+
+void Hatcher::run (Layer &output)
+{
+    // concentric rings are not scanline work, see concentricRings
+    if (m_table.isEmpty () || ! (m_spec.interval > 0.0) || m_spec.type == Layer::InfillSpec::Concentric)
+    {
+        return;
+    }
+
+    const int firstLine (int (std::ceil (m_lowerY / m_spec.interval)));
+    const int lastLine (int (std::floor (m_upperY / m_spec.interval)));
+    QVector<Crossing> crossings;
+
+    if (m_spec.type != Layer::InfillSpec::ZigzagContinuous)
+    {
+        const bool alternate (m_spec.type == Layer::InfillSpec::Zigzag);
+        for (int line = firstLine; line <= lastLine; ++line)
+        {
+            scan (line, crossings);
+            emitSegments (crossings, line, alternate, output);
+        }
+        return;
+    }
+
+    // ZigzagContinuous: each span of the previous scanline that has a chain leaves it
+    // at one end, and the chain takes over the span of this scanline reached by following
+    // the boundary from that end; spans nobody reaches start new chains
+    class Span
+    {
+    public:
+        int chain;
+        int exitEdge;
+    };
+
+    QVector<Span> previous, current;
+    QVector<int> slotLine (m_edges.count (), firstLine - 1);
+    QVector<int> slotIndex (m_edges.count (), -1);
+    QVector<bool> claimed;
+    QVector<Point> path;
+
+    for (int line = firstLine; line <= lastLine; ++line)
+    {
+        scan (line, crossings);
+        const qreal y (line * m_spec.interval);
+
+        for (int i = 0; i < crossings.count (); ++i)
+        {
+            slotLine [crossings.at (i).edge] = line;
+            slotIndex [crossings.at (i).edge] = i;
+        }
+
+        const int spans (crossings.count () / 2);
+        current.fill (Span {-1, -1}, spans);
+        claimed.fill (false, spans);
+
+        for (const Span &span : previous)
+        {
+            int next (-1);
+            if (! follow (span.exitEdge, line - 1, path, next) || slotLine.at (next) != line)
+            {
+                continue;
+            }
+
+            const int entry (slotIndex.at (next));
+            const int index (entry / 2);
+            if (claimed.at (index))
+            {
+                continue;
+            }
+            claimed [index] = true;
+
+            // enter at one end of the span and leave at the other
+            const int exit (entry % 2 == 0 ? entry + 1 : entry - 1);
+            Polygon &polygon (output [span.chain]);
+            polygon.append (path);
+            const Point start (toPoint (crossings.at (entry).x, y));
+            if (polygon.last ().x () != start.x () || polygon.last ().y () != start.y ())
+            {
+                polygon.append (start);
+            }
+            polygon.append (toPoint (crossings.at (exit).x, y));
+            current [index] = Span {span.chain, crossings.at (exit).edge};
+        }
+
+        for (int index = 0; index < spans; ++index)
+        {
+            if (claimed.at (index))
+            {
+                continue;
+            }
+
+            const int entry (line % 2 == 0 ? 2 * index : 2 * index + 1);
+            const int exit (line % 2 == 0 ? 2 * index + 1 : 2 * index);
+            Polygon polygon;
+            polygon.setType (Polygon::Infill);
+            polygon.append (toPoint (crossings.at (entry).x, y));
+            polygon.append (toPoint (crossings.at (exit).x, y));
+            current [index] = Span {output.count (), crossings.at (exit).edge};
+            output.append (polygon);
+        }
+
+        std::swap (previous, current);
+    }
+}
+
+/**
+ * @brief 将 region 逐次向内偏置 spec.interval 得到的同心环, 第一环距边界 spec.interval 的一半
+ *
+ * 环按行程排序, 每环的起点旋转到离上一环起点最近的顶点, 因此同一块区域的环由外向内相继.
+ */
+void concentricRings (IntRings region, const Layer::InfillSpec &spec, qreal z, Layer &output)
+{
+    const qreal step (spec.interval * planarScale);
+    if (! (step >= 1.0))
+    {
+        return;
+    }
+
+    Layer rings;
+    region = offsetRegion (region, -0.5 * step, Polygon::RoundJoin, 2.0, planarArcTolerance);
+    while (! region.isEmpty ())
+    {
+        for (const IntRing &ring : region)
+        {
+            rings.append (toPolygon (ring, z, Polygon::Infill));
+        }
+        region = offsetRegion (region, -step, Polygon::RoundJoin, 2.0, planarArcTolerance);
+    }
+
+    rings.optimize ();
+    for (int r = 1; r < rings.count (); ++r)
+    {
+        const Point last (rings.at (r - 1).last ());
+        Polygon &ring (rings [r]);
+
+        // the ring is closed, its last vertex repeats the first
+        int nearest (0);
+        qreal distance (INFINITY);
+        for (int i = 0; i + 1 < ring.count (); ++i)
+        {
+            const qreal d (ring.at (i).distance2D (last));
+            if (d < distance)
+            {
+                nearest = i;
+                distance = d;
+            }
+        }
+        if (nearest > 0)
+        {
+            ring.removeLast ();
+            std::rotate (ring.begin (), ring.begin () + nearest, ring.end ());
+            ring.append (ring.first ());
+        }
+    }
+    output.append (rings);
+}
+
+}
+
+void hatchLayer (const Layer &layer, const Layer::InfillSpec &spec, Layer &output)
+{
+    Hatcher hatcher (layer, spec);
+    hatcher.run (output);
+}
+
+void fillLayer (const Layer &layer, const Layer::InfillSpec &spec, Layer &output)
+{
+    const bool inset ((spec.extraContourCount > 0 && spec.extraContourWidth > 0.0) || spec.shrinkWidth != 0.0);
+    if (! inset && spec.type != Layer::InfillSpec::Concentric)
+    {
+        hatchLayer (layer, spec, output);
+        return;
+    }
+
+    IntRings rings;
+    qreal z (0.0);
+    for (const Polygon &polygon : layer)
+    {
+        if (polygon.type () != Polygon::Contour || polygon.count () < 3)
+        {
+            continue;
+        }
+        if (rings.isEmpty ())
+        {
+            z = polygon.first ().z ();
+        }
+        rings.append (toIntRing (polygon));
+    }
+
+    IntRings region (resolveRings (rings, EvenOddFill));
+    if (spec.extraContourWidth > 0.0)
+    {
+        for (int i = 0; i < spec.extraContourCount && ! region.isEmpty (); ++i)
+        {
+            region = offsetRegion (region, -spec.extraContourWidth * planarScale, Polygon::RoundJoin, 2.0, planarArcTolerance);
+            for (const IntRing &ring : region)
+            {
+                output.append (toPolygon (ring, z, Polygon::Extra));
+            }
+        }
+    }
+    region = offsetRegion (region, -spec.shrinkWidth * planarScale, Polygon::RoundJoin, 2.0, planarArcTolerance);
+
+    if (spec.type == Layer::InfillSpec::Concentric)
+    {
+        concentricRings (region, spec, z, output);
+        return;
+    }
+
+    Layer contours;
+    contours.reserve (region.count ());
+    for (const IntRing &ring : region)
+    {
+        contours.append (toPolygon (ring, z, Polygon::Contour));
+    }
+    hatchLayer (contours, spec, output);
+}
@@ -0,0 +1,23 @@
+﻿#ifndef INFILL_H
+#define INFILL_H
+
+#include "layer.h"
+
+/**
+ * @brief 以扫描线法生成 layer 中 Contour 多边形所围区域的填充线
+ *
+ * 各 Contour 多边形视为闭合环, 按奇偶规则判断内外, 因此孔洞无需区分方向.
+ * 扫描线沿 spec.angle 方向, 间距 spec.interval, 位于间距的整数倍上, 使相邻层的填充线对齐.
+ * @param output 生成的 Infill 多边形追加到其末尾
+ */
+void hatchLayer (const Layer &layer, const Layer::InfillSpec &spec, Layer &output);
+
+/**
+ * @brief Layer::infill 的实现, 生成 Extra 轮廓, 再以扫描线或同心环填充剩余区域
+ *
+ * Extra 轮廓, 收缩与同心环都是逐次向内偏置, 每一次都在上一次的结果上进行.
+ * @param output 生成的多边形追加到其末尾
+ */
+void fillLayer (const Layer &layer, const Layer::InfillSpec &spec, Layer &output);
+
+#endif // INFILL_H
@@ -0,0 +1,201 @@
+﻿#include "kernels.h"
+#include <algorithm>
+
+// AVX2 is opt-in through the SLCKIT_USE_AVX2 CMake option, SSE2 is part of every x86-64 target
+#if defined (__AVX2__)
+#define SLCKIT_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SLCKIT_SSE2
+#include <emmintrin.h>
+#endif
+
+// The vector loops read the packed (x, y, z) triples without deinterleaving.
+// N points are 3N doubles, so a register of width W sees the coordinates in a
+// rotating order: for SSE2 (2 lanes) the three loads of 2 points hold (x, y),
+// (z, x) and (y, z); for AVX (4 lanes) the three loads of 4 points hold
+// (x, y, z, x), (y, z, x, y) and (z, x, y, z). Each load keeps its own
+// accumulator, whose lanes are folded back into x, y and z at the end.
+
+void boundaryKernel (const Point *points, int count, qreal *lower, qreal *upper)
+{
+    const qreal *data (reinterpret_cast<const qreal *> (points));
+    int i (0);
+
+#if defined (SLCKIT_AVX2)
+    if (count >= 4)
+    {
+        // _mm256_min_pd (a, b) returns b when a is NaN, so NaN coordinates are skipped as in Boundary::refer
+        __m256d min0 (_mm256_set_pd (lower [0], lower [2], lower [1], lower [0]));
+        __m256d min1 (_mm256_set_pd (lower [1], lower [0], lower [2], lower [1]));
+        __m256d min2 (_mm256_set_pd (lower [2], lower [1], lower [0], lower [2]));
+        __m256d max0 (_mm256_set_pd (upper [0], upper [2], upper [1], upper [0]));
+        __m256d max1 (_mm256_set_pd (upper [1], upper [0], upper [2], upper [1]));
+        __m256d max2 (_mm256_set_pd (upper [2], upper [1], upper [0], upper [2]));
+
+        for (; i + 4 <= count; i += 4)
+        {
+            const qreal *p (data + 3 * i);
+            __m256d a (_mm256_loadu_pd (p));
+            __m256d b (_mm256_loadu_pd (p + 4));
+            __m256d c (_mm256_loadu_pd (p + 8));
+            min0 = _mm256_min_pd (a, min0);
+            min1 = _mm256_min_pd (b, min1);
+            min2 = _mm256_min_pd (c, min2);
+            max0 = _mm256_max_pd (a, max0);
+            max1 = _mm256_max_pd (b, max1);
+            max2 = _mm256_max_pd (c, max2);
+        }
+
+        double l0 [4], l1 [4], l2 [4], u0 [4], u1 [4], u2 [4];
+        _mm256_storeu_pd (l0, min0);
+        _mm256_storeu_pd (l1, min1);
+        _mm256_storeu_pd (l2, min2);
+        _mm256_storeu_pd (u0, max0);
+        _mm256_storeu_pd (u1, max1);
+        _mm256_storeu_pd (u2, max2);
+
+        lower [0] = std::min (std::min (l0 [0], l0 [3]), std::min (l1 [2], l2 [1]));
+        lower [1] = std::min (std::min (l0 [1], l1 [0]), std::min (l1 [3], l2 [2]));
+        lower [2] = std::min (std::min (l0 [2], l1 [1]), std::min (l2 [0], l2 [3]));
+        upper [0] = std::max (std::max (u0 [0], u0 [3]), std::max (u1 [2], u2 [1]));
+        upper [1] = std::max (std::max (u0 [1], u1 [0]), std::max (u1 [3], u2 [2]));
+        upper [2] = std::max (std::max (u0 [2], u1 [1]), std::max (u2 [0], u2 [3]));
+    }
+#elif defined (SLCKIT_SSE2)
+    if (count >= 2)
+    {
+        // _mm_min_pd (a, b) returns b when a is NaN, so NaN coordinates are skipped as in Boundary::refer
+        __m128d min0 (_mm_set_pd (lower [1], lower [0]));
+        __m128d min1 (_mm_set_pd (lower [0], lower [2]));
+        __m128d min2 (_mm_set_pd (lower [2], lower [1]));
+        __m128d max0 (_mm_set_pd (upper [1], upper [0]));
+        __m128d max1 (_mm_set_pd (upper [0], upper [2]));
+        __m128d max2 (_mm_set_pd (upper [2], upper [1]));
+
+        for (; i + 2 <= count; i += 2)
+        {
+            const qreal *p (data + 3 * i);
+            __m128d a (_mm_loadu_pd (p));
+            __m128d b (_mm_loadu_pd (p + 2));
+            __m128d c (_mm_loadu_pd (p + 4));
+            min0 = _mm_min_pd (a, min0);
+            min1 = _mm_min_pd (b, min1);
+            min2 = _mm_min_pd (c, min2);
+            max0 = _mm_max_pd (a, max0);
+            max1 = _mm_max_pd (b, max1);
+            max2 = _mm_max_pd (c, max2);
+        }
+
+        double l0 [2], l1 [2], l2 [2], u0 [2], u1 [2], u2 [2];
+        _mm_storeu_pd (l0, min0);
+        _mm_storeu_pd (l1, min1);
+        _mm_storeu_pd (l2, min2);
+        _mm_storeu_pd (u0, max0);
+        _mm_storeu_pd (u1, max1);
+        _mm_storeu_pd (u2, max2);
+
+        lower [0] = std::min (l0 [0], l1 [1]);
+        lower [1] = std::min (l0 [1], l2 [0]);
+        lower [2] = std::min (l1 [0], l2 [1]);
+        upper [0] = std::max (u0 [0], u1 [1]);
+        upper [1] = std::max (u0 [1], u2 [0]);
+        upper [2] = std::max (u1 [0], u2 [1]);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const qreal *p (data + 3 * i);
+        for (int k = 0; k < 3; ++k)
+        {
+            if (p [k] < lower [k])
+                lower [k] = p [k];
+            if (p [k] > upper [k])
+                upper [k] = p [k];
+        }
+    }
+}
+
+void translateKernel (Point *points, int count, const Point &offset)
+{
+    qreal *data (reinterpret_cast<qreal *> (points));
+    const qreal x (offset.x ());
+    const qreal y (offset.y ());
+    const qreal z (offset.z ());
+    int i (0);
+
+#if defined (SLCKIT_AVX2)
+    {
+        const __m256d o0 (_mm256_set_pd (x, z, y, x));
+        const __m256d o1 (_mm256_set_pd (y, x, z, y));
+        const __m256d o2 (_mm256_set_pd (z, y, x, z));
+        for (; i + 4 <= count; i += 4)
+        {
+            qreal *p (data + 3 * i);
+            _mm256_storeu_pd (p, _mm256_add_pd (_mm256_loadu_pd (p), o0));
+            _mm256_storeu_pd (p + 4, _mm256_add_pd (_mm256_loadu_pd (p + 4), o1));
+            _mm256_storeu_pd (p + 8, _mm256_add_pd (_mm256_loadu_pd (p + 8), o2));
+        }
+    }
+#elif defined (SLCKIT_SSE2)
+    {
+        const __m128d o0 (_mm_set_pd (y, x));
+        const __m128d o1 (_mm_set_pd (x, z));
+        const __m128d o2 (_mm_set_pd (z, y));
+        for (; i + 2 <= count; i += 2)
+        {
+            qreal *p (data + 3 * i);
+            _mm_storeu_pd (p, _mm_add_pd (_mm_loadu_pd (p), o0));
+            _mm_storeu_pd (p + 2, _mm_add_pd (_mm_loadu_pd (p + 2), o1));
+            _mm_storeu_pd (p + 4, _mm_add_pd (_mm_loadu_pd (p + 4), o2));
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        qreal *p (data + 3 * i);
+        p [0] += x;
+        p [1] += y;
+        p [2] += z;
+    }
+}
+
+qreal crossSumKernel (const Point *points, int count)
+{
+    const qreal *data (reinterpret_cast<const qreal *> (points));
+    qreal sum (0.0);
+    int i (0);
+
+#if defined (SLCKIT_SSE2)
+    // two terms per step: (x[i], x[i+1]) * (y[i+1], y[i+2]) - (x[i+1], x[i+2]) * (y[i], y[i+1])
+    __m128d acc (_mm_setzero_pd ());
+    for (; i + 2 < count; i += 2)
+    {
+        const qreal *p (data + 3 * i);
+        __m128d p0 (_mm_loadu_pd (p));
+        __m128d p1 (_mm_loadu_pd (p + 3));
+        __m128d p2 (_mm_loadu_pd (p + 6));
+        __m128d x01 (_mm_unpacklo_pd (p0, p1));
+        __m128d y01 (_mm_unpackhi_pd (p0, p1));
+        __m128d x12 (_mm_unpacklo_pd (p1, p2));
+        __m128d y12 (_mm_unpackhi_pd (p1, p2));
+        acc = _mm_add_pd (acc, _mm_sub_pd (_mm_mul_pd (x01, y12), _mm_mul_pd (x12, y01)));
+    }
+
+    double lanes [2];
+    _mm_storeu_pd (lanes, acc);
+    sum = lanes [0] + lanes [1];
+#endif
+
+    for (; i < count - 1; ++i)
+    {
+        const qreal *p0 (data + 3 * i);
+        const qreal *p1 (p0 + 3);
+        sum += p0 [0] * p1 [1] - p1 [0] * p0 [1];
+    }
+    return sum;
+}
@@ -0,0 +1,43 @@
+﻿#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "boundary.h"
+
+// the kernels walk a Point array as packed (x, y, z) triples
+static_assert (sizeof (Point) == 3 * sizeof (qreal), "Point must be three packed qreal values");
+
+/**
+ * @brief 以 lower, upper 为初值, 求 count 个点各坐标的最小值与最大值
+ *
+ * 结果与逐点调用 Boundary::refer 相同, 含 NaN 的坐标被忽略.
+ * @param lower 三个元素的数组 (x, y, z), 输入初值, 输出最小值
+ * @param upper 三个元素的数组 (x, y, z), 输入初值, 输出最大值
+ */
+void boundaryKernel (const Point *points, int count, qreal *lower, qreal *upper);
+
+/**
+ * @brief 将 count 个点逐一加上 offset
+ */
+void translateKernel (Point *points, int count, const Point &offset);
+
+/**
+ * @brief 求 Polygon::area 所用的叉积和, 即 i 从 0 到 count - 2 的 x[i]*y[i+1] - x[i+1]*y[i] 之和
+ */
+qreal crossSumKernel (const Point *points, int count);
+
+/**
+ * @brief 由 boundaryKernel 的结果构造 Boundary
+ */
+static inline const Boundary kernelBoundary (const qreal *lower, const qreal *upper)
+{
+    Boundary boundary;
+    boundary.setMinX (lower [0]);
+    boundary.setMinY (lower [1]);
+    boundary.setMinZ (lower [2]);
+    boundary.setMaxX (upper [0]);
+    boundary.setMaxY (upper [1]);
+    boundary.setMaxZ (upper [2]);
+    return boundary;
+}
+
+#endif // KERNELS_H
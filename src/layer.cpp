@@ -1,4 +1,25 @@
 ﻿#include "layer.h"
+#include "endpointindex.h"
+#include "infill.h"
+#include "kernels.h"
+#include "planar.h"
+#include "profiling.h"
+#include <QElapsedTimer>
+
+bool Layer::InfillSpec::operator == (const InfillSpec &other) const
+{
+    return (type == other.type &&
+            fuzzyIsEqual (interval, other.interval) &&
+            fuzzyIsEqual (angle, other.angle) &&
+            fuzzyIsEqual (shrinkWidth, other.shrinkWidth) &&
+            extraContourCount == other.extraContourCount &&
+            fuzzyIsEqual (extraContourWidth, other.extraContourWidth));
+}
+
+bool Layer::InfillSpec::operator != (const InfillSpec &other) const
+{
+    return ! operator == (other);
+}
 
 void Layer::setThickness (const qreal thickness)
 {
@@ -20,13 +41,24 @@ qreal Layer::height() const
     return m_height;
 }
 
-const Layer Layer::translated(const Point &offset) const
+Layer Layer::translated(const Point &offset) const &
 {
     Layer other (*this);
     other.translate (offset);
     return other;
 }
 
+/**
+ * @brief 右值版本, 在本层上原地平移后移出
+ *
+ * 链式调用如 Layer (...).translated (a).optimized () 全程只有一份数据.
+ */
+Layer Layer::translated(const Point &offset) &&
+{
+    translate (offset);
+    return std::move (*this);
+}
+
 void Layer::translate(const Point &offset)
 {
     for (Polygon &polygon : *this)
@@ -37,12 +69,13 @@ void Layer::translate(const Point &offset)
 
 const Boundary Layer::boundary () const
 {
-    Boundary boundary;
+    qreal lower [3] = {INFINITY, INFINITY, INFINITY};
+    qreal upper [3] = {-INFINITY, -INFINITY, -INFINITY};
     for (const Polygon &polygon : *this)
     {
-        boundary.refer (polygon.boundary ());
+        boundaryKernel (polygon.constData (), polygon.count (), lower, upper);
     }
-    return boundary;
+    return kernelBoundary (lower, upper);
 }
 
 const Point Layer::center() const
@@ -132,143 +165,756 @@ void Layer::sort(Layer::SortPattern pattern)
     std::stable_sort (begin (), end (), functor);
 }
 
-const Layer Layer::sorted(Layer::SortPattern pattern) const
+Layer Layer::sorted(Layer::SortPattern pattern) const &
 {
     Layer other (*this);
     other.sort (pattern);
     return other;
 }
 
+Layer Layer::sorted(Layer::SortPattern pattern) &&
+{
+    sort (pattern);
+    return std::move (*this);
+}
+
+/**
+ * @brief 以贪心最近邻方式重排多边形, 缩短空行程
+ *
+ * 第一个非空多边形保持在最前, 若其末端点离 reference 更近则反向;
+ * 之后每一步从剩余多边形中取端点离上一多边形终点最近者, 若最近的是末端点则反向.
+ * 最近邻查询由端点 k-d 树完成, 整体约为 O(n log n). 空多边形移至最后.
+ * @return 最后一个多边形的终点, 无非空多边形时返回 reference
+ */
 const Point Layer::optimize(const Point &reference)
 {
-    int N = count ();
+    SLCKIT_PROFILE_SCOPE ("Layer::optimize");
+
+    const int N = count ();
     Point last = reference;
 
-    // 0,1,2 elements
-    if (N < 1)
+    int start (0);
+    while (start < N && at (start).isEmpty ())
+    {
+        ++start;
+    }
+
+    if (start >= N)
     {
         return last;
     }
 
-    int i = 0;
-    for (; i < N; ++i)
+    QVector<int> empties;
+    for (int i = start + 1; i < N; ++i)
     {
-        Polygon &polygon = (*this) [i];
-        if (!polygon.isEmpty ())
+        if (at (i).isEmpty ())
         {
-            if (polygon.first ().distance2D (last) > polygon.last ().distance2D (last))
-            {
-                polygon.reverse ();
-            }
+            empties.append (i);
+        }
+    }
+
+    Polygon *polygons (data ());
+    EndpointIndex index (polygons, N);
+    QVector<Polygon> ordered (N);
+    int placed (0);
 
-            last = polygon.last ();
-            break;
+    Polygon &first (polygons [start]);
+    if (first.first ().distance2D (last) > first.last ().distance2D (last))
+    {
+        first.reverse ();
+    }
+    last = first.last ();
+    index.remove (start);
+    std::swap (ordered [placed++], first);
+
+    int next (0);
+    bool flip (false);
+    while (index.nearest (last, next, flip))
+    {
+        Polygon &target (polygons [next]);
+        if (flip)
+        {
+            target.reverse ();
         }
+        last = target.last ();
+        index.remove (next);
+        std::swap (ordered [placed++], target);
     }
 
-    for (; i < N - 1; ++i)
+    // empty polygons keep their relative order at the end
+    for (int i = 0; i < start; ++i)
     {
-        const Polygon &polygon = at (i);
+        std::swap (ordered [placed++], polygons [i]);
+    }
+    for (int i : empties)
+    {
+        std::swap (ordered [placed++], polygons [i]);
+    }
+
+    swap (ordered);
+    return last;
+}
+
+Layer Layer::optimized(const Point &reference) const &
+{
+    Layer other (*this);
+    other.optimize (reference);
+    return other;
+}
+
+Layer Layer::optimized(const Point &reference) &&
+{
+    optimize (reference);
+    return std::move (*this);
+}
+
+const Point Layer::optimize(Layer::SortPattern pattern, const Point &reference)
+{
+    sort (pattern);
+
+    Point last = reference;
+
+    Layer flatterned [Polygon::PolygonTypeCount];
+    for (const Polygon &polygon : *this)
+    {
+        int p (priority (pattern, polygon.type ()));
+        flatterned [p].append (polygon);
+    }
+
+    clear ();
+
+    for (int i = 0; i < Polygon::PolygonTypeCount; ++i)
+    {
+        Layer &layer = flatterned[i];
+        last = layer.optimize (last);
+        append (layer);
+    }
+    return last;
+}
+
+Layer Layer::optimized(Layer::SortPattern pattern, const Point &reference) const &
+{
+    Layer other (*this);
+    other.optimize (pattern, reference);
+    return other;
+}
 
-        // if empty
+Layer Layer::optimized(Layer::SortPattern pattern, const Point &reference) &&
+{
+    optimize (pattern, reference);
+    return std::move (*this);
+}
+
+/**
+ * @brief 按当前顺序计算空行程总长
+ * @param reference 起点, 无效时不计第一段行程
+ */
+qreal Layer::travelDistance(const Point &reference) const
+{
+    qreal distance (0.0);
+    Point last = reference;
+    for (const Polygon &polygon : *this)
+    {
         if (polygon.isEmpty ())
         {
             continue;
         }
 
-        QVector<qreal> distance1, distance2;
+        if (last.isValid ())
+        {
+            distance += last.distance2D (polygon.first ());
+        }
+        last = polygon.last ();
+    }
+    return distance;
+}
 
-        int next = i + 1;
+static inline qreal planarDistance (const Point &a, const Point &b)
+{
+    const qreal dx (a.x () - b.x ());
+    const qreal dy (a.y () - b.y ());
+    return std::sqrt (dx * dx + dy * dy);
+}
 
-        for (int j = next; j < N; ++j)
+/**
+ * @brief 以 2-opt 与 Or-opt 改进 polygons [0, count) 的顺序及方向
+ *
+ * 路径从 reference 出发, 终点自由. 2-opt 将一段多边形整体倒序并逐个反向,
+ * Or-opt 将至多 segmentLength 个相邻多边形 (可反向) 移到别处; 每次只接受使行程变短的移动.
+ * Or-opt 只尝试段首尾各自最近的 neighbourCount 个多边形前后的位置, neighbourCount 不大于 0 时尝试所有位置.
+ * @return 最后一个多边形的终点, 无非空多边形时返回 reference
+ */
+static const Point refineRange (Polygon *polygons,
+                                int count,
+                                const Point &reference,
+                                const Layer::RefineSpec &spec,
+                                const QElapsedTimer &timer,
+                                Layer::RefineReport &report)
+{
+    QVector<int> slots, empties;
+    for (int i = 0; i < count; ++i)
+    {
+        if (polygons [i].isEmpty ())
         {
-            const Polygon &p (at (j));
-            if (!p.isEmpty ())
-            {
-                distance1.append (p.first ().distance2D (last));
-                distance2.append (p.last ().distance2D (last));
-            }
-            else
+            empties.append (i);
+        }
+        else
+        {
+            slots.append (i);
+        }
+    }
+
+    const int n (slots.count ());
+    if (n == 0)
+    {
+        return reference;
+    }
+
+    // path holds node ids, node k being polygons [slots [k]]
+    QVector<int> path (n);
+    QVector<bool> flipped (n, false);
+    QVector<Point> firsts (n), lasts (n);
+    for (int k = 0; k < n; ++k)
+    {
+        path [k] = k;
+        firsts [k] = polygons [slots.at (k)].first ();
+        lasts [k] = polygons [slots.at (k)].last ();
+    }
+
+    // positionOf [node] is the inverse of path
+    QVector<int> positionOf (path);
+
+    // Or-opt candidates of node k are at [k * stride, (k + 1) * stride), padded with -1
+    const bool allGaps (spec.neighbourCount <= 0 || spec.neighbourCount >= n - 1);
+    const int stride (allGaps ? 0 : spec.neighbourCount * 2);
+    QVector<int> neighbours;
+    if (spec.orOpt && ! allGaps)
+    {
+        QVector<int> nodeOf (count, -1);
+        for (int k = 0; k < n; ++k)
+        {
+            nodeOf [slots.at (k)] = k;
+        }
+
+        const EndpointIndex index (polygons, count);
+        neighbours.fill (-1, n * stride);
+        QVector<int> found;
+        for (int k = 0; k < n; ++k)
+        {
+            int *candidates (neighbours.data () + k * stride);
+            int used (0);
+            for (const Point &point : {firsts.at (k), lasts.at (k)})
             {
-                distance1.append (INFINITY);
-                distance2.append (INFINITY);
+                index.neighbours (point, spec.neighbourCount + 1, found);
+                int taken (0);
+                for (int polygon : found)
+                {
+                    const int node (nodeOf.at (polygon));
+                    if (node == k || taken == spec.neighbourCount ||
+                        std::find (candidates, candidates + used, node) != candidates + used)
+                    {
+                        continue;
+                    }
+                    candidates [used++] = node;
+                    ++taken;
+                }
             }
         }
+    }
 
-        int index (next);
+    const bool hasReference (reference.isValid ());
 
-        int index1 = std::min_element (distance1.cbegin (), distance1.cend ()) - distance1.cbegin ();
-        int index2 = std::min_element (distance2.cbegin (), distance2.cend ()) - distance2.cbegin ();
+    auto startOf = [&] (int position) -> const Point &
+    {
+        const int node (path.at (position));
+        return flipped.at (node) ? lasts.at (node) : firsts.at (node);
+    };
+    auto endOf = [&] (int position) -> const Point &
+    {
+        const int node (path.at (position));
+        return flipped.at (node) ? firsts.at (node) : lasts.at (node);
+    };
+    // leg arriving at `to` when it is placed at position, from the previous end or the reference
+    auto legTo = [&] (int position, const Point &to) -> qreal
+    {
+        if (position > 0)
+            return planarDistance (endOf (position - 1), to);
+        return hasReference ? planarDistance (reference, to) : 0.0;
+    };
+    // leg leaving `from` towards the polygon at position, none past the end
+    auto legFrom = [&] (const Point &from, int position) -> qreal
+    {
+        return (position < n) ? planarDistance (from, startOf (position)) : 0.0;
+    };
+    auto exhausted = [&] () -> bool
+    {
+        return (spec.timeLimit > 0 && timer.elapsed () >= spec.timeLimit);
+    };
+    auto reverseRange = [&] (int first, int last)
+    {
+        std::reverse (path.begin () + first, path.begin () + last + 1);
+        for (int position = first; position <= last; ++position)
+        {
+            flipped [path.at (position)] = ! flipped.at (path.at (position));
+            positionOf [path.at (position)] = position;
+        }
+    };
 
-        qreal d1 = distance1.at (index1);
-        qreal d2 = distance2.at (index2);
+    const qreal epsilon (PREC);
+    int passes (0);
+    bool improved (true);
+    while (improved && passes < spec.passLimit && ! exhausted ())
+    {
+        improved = false;
+        ++passes;
 
-        bool flip (false);
-        if (d2 < d1)
+        // 2-opt: traverse [i, j] backwards, only the two boundary legs change
+        for (int i = 0; spec.twoOpt && i < n && ! exhausted (); ++i)
         {
-            flip = true;
-            index += index2;
+            for (int j = i; j < n; ++j)
+            {
+                // reading the clock costs about as much as a candidate, so do it every 64
+                if ((j - i) % 64 == 63 && exhausted ())
+                {
+                    break;
+                }
+
+                const Point &start (startOf (i));
+                const Point &end (endOf (j));
+                qreal before (legTo (i, start) + legFrom (end, j + 1));
+                qreal after (legTo (i, end) + legFrom (start, j + 1));
+                if (after < before - epsilon)
+                {
+                    reverseRange (i, j);
+                    ++report.moves;
+                    improved = true;
+                }
+            }
         }
-        else
+
+        // Or-opt: move [i, k] into the gap before position g, possibly reversed
+        for (int length = 1; spec.orOpt && length <= spec.segmentLength && length < n; ++length)
         {
-            index += index1;
+            for (int i = 0; i + length <= n && ! exhausted (); ++i)
+            {
+                const int k (i + length - 1);
+                const Point start (startOf (i));
+                const Point end (endOf (k));
+
+                qreal removal (legTo (i, start) + legFrom (end, k + 1));
+                if (k + 1 < n)
+                {
+                    removal -= legTo (i, startOf (k + 1));
+                }
+
+                int bestGap (-1);
+                bool bestReversed (false);
+                qreal bestDelta (-epsilon);
+                auto tryGap = [&] (int g)
+                {
+                    if (g >= i && g <= k + 1)
+                    {
+                        return;
+                    }
+
+                    const qreal base ((g < n) ? legTo (g, startOf (g)) : 0.0);
+                    const qreal forward (legTo (g, start) + legFrom (end, g) - base - removal);
+                    const qreal backward (legTo (g, end) + legFrom (start, g) - base - removal);
+                    if (forward < bestDelta)
+                    {
+                        bestDelta = forward;
+                        bestGap = g;
+                        bestReversed = false;
+                    }
+                    if (backward < bestDelta)
+                    {
+                        bestDelta = backward;
+                        bestGap = g;
+                        bestReversed = true;
+                    }
+                };
+
+                if (allGaps)
+                {
+                    for (int g = 0; g <= n; ++g)
+                    {
+                        tryGap (g);
+                    }
+                }
+                else
+                {
+                    // before or after each neighbour of the segment's first and last polygon
+                    for (const int node : {path.at (i), path.at (k)})
+                    {
+                        const int *candidates (neighbours.constData () + node * stride);
+                        for (int c = 0; c < stride && candidates [c] >= 0; ++c)
+                        {
+                            tryGap (positionOf.at (candidates [c]));
+                            tryGap (positionOf.at (candidates [c]) + 1);
+                        }
+                    }
+                }
+
+                if (bestGap >= 0)
+                {
+                    if (bestReversed)
+                    {
+                        reverseRange (i, k);
+                    }
+                    const int first (qMin (bestGap, i));
+                    const int last (qMax (bestGap, k + 1));
+                    if (bestGap < i)
+                    {
+                        std::rotate (path.begin () + bestGap, path.begin () + i, path.begin () + k + 1);
+                    }
+                    else
+                    {
+                        std::rotate (path.begin () + i, path.begin () + k + 1, path.begin () + bestGap);
+                    }
+                    for (int position = first; position < last; ++position)
+                    {
+                        positionOf [path.at (position)] = position;
+                    }
+                    ++report.moves;
+                    improved = true;
+                }
+            }
         }
+    }
+    report.passes += passes;
 
-        Polygon &current ((*this)[next]);
-        Polygon &target  ((*this)[index]);
+    // apply the new order, empty polygons keep their relative order at the end
+    QVector<Polygon> ordered;
+    ordered.reserve (count);
+    for (int position = 0; position < n; ++position)
+    {
+        const int node (path.at (position));
+        Polygon &polygon (polygons [slots.at (node)]);
+        if (flipped.at (node))
+        {
+            polygon.reverse ();
+        }
+        ordered.append (Polygon ());
+        std::swap (ordered.last (), polygon);
+    }
+    for (int i : empties)
+    {
+        ordered.append (Polygon ());
+        std::swap (ordered.last (), polygons [i]);
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        std::swap (polygons [i], ordered [i]);
+    }
 
-        // last = target.constLast ();
+    return polygons [n - 1].last ();
+}
 
-        if (flip)
+const Point Layer::refine(const Point &reference)
+{
+    return refine (reference, RefineSpec ());
+}
+
+const Point Layer::refine(Layer::SortPattern pattern, const Point &reference)
+{
+    return refine (pattern, reference, RefineSpec ());
+}
+
+/**
+ * @brief 在 optimize () 的结果上以 2-opt 与 Or-opt 进一步缩短空行程
+ * @param spec 改进的轮数及时间上限 (毫秒, 0 表示不限), 默认 1 秒
+ * @param report 若不为空, 返回改进前后的行程长度及移动次数
+ * @return 最后一个多边形的终点
+ */
+const Point Layer::refine(const Point &reference, const RefineSpec &spec, RefineReport *report)
+{
+    QElapsedTimer timer;
+    timer.start ();
+
+    RefineReport result;
+    result.initialDistance = travelDistance (reference);
+    Point last = refineRange (data (), count (), reference, spec, timer, result);
+    result.finalDistance = travelDistance (reference);
+
+    if (report != nullptr)
+    {
+        *report = result;
+    }
+    return last;
+}
+
+/**
+ * @brief 与 optimize (SortPattern, ...) 配合使用, 多边形按类型分组后在各组内分别改进,
+ * 前一组的终点作为后一组的起点, 时间上限由各组共享. 若总行程反而变长则保持原顺序
+ */
+const Point Layer::refine(Layer::SortPattern pattern, const Point &reference, const RefineSpec &spec, RefineReport *report)
+{
+    sort (pattern);
+
+    QElapsedTimer timer;
+    timer.start ();
+
+    RefineReport result;
+    result.initialDistance = travelDistance (reference);
+
+    // a new end point of one group may lengthen the first leg of the next
+    const Layer backup (*this);
+
+    Point last = reference;
+    int first (0);
+    while (first < count ())
+    {
+        const int group (priority (pattern, at (first).type ()));
+        int end (first + 1);
+        while (end < count () && priority (pattern, at (end).type ()) == group)
         {
-            target.reverse ();
+            ++end;
         }
 
-        last = target.last ();
+        last = refineRange (data () + first, end - first, last, spec, timer, result);
+        first = end;
+    }
+    result.finalDistance = travelDistance (reference);
+
+    if (result.finalDistance > result.initialDistance)
+    {
+        *this = backup;
+        result.finalDistance = result.initialDistance;
+        result.moves = 0;
 
-        std::swap (current, target);
+        last = reference;
+        for (const Polygon &polygon : *this)
+        {
+            if (! polygon.isEmpty ())
+            {
+                last = polygon.last ();
+            }
+        }
+    }
+
+    if (report != nullptr)
+    {
+        *report = result;
     }
     return last;
 }
 
-const Layer Layer::optimized(const Point &reference) const
+/**
+ * @brief 将 Contour 多边形按奇偶规则围成的区域向外偏置 distance, distance 为负时向内收缩
+ *
+ * 区域的自交与重叠一并消解. 偏置后的轮廓外环逆时针, 孔洞顺时针, 均已闭合,
+ * 替换原有的 Contour 多边形追加在层末尾, 其它类型的多边形保持不变.
+ * @param join 尖角的连接方式
+ * @param miterLimit MiterJoin 时尖角长度与 distance 之比的上限, 超过时按 BevelJoin 处理
+ */
+void Layer::offset(qreal distance, Polygon::JoinType join, qreal miterLimit)
+{
+    IntRings rings;
+    qreal z (0.0);
+    int kept (0);
+    for (int i = 0; i < count (); ++i)
+    {
+        const Polygon &polygon (at (i));
+        if (polygon.type () != Polygon::Contour)
+        {
+            if (kept != i)
+            {
+                (*this) [kept] = polygon;
+            }
+            ++kept;
+            continue;
+        }
+        if (polygon.count () < 3)
+        {
+            continue;
+        }
+        if (rings.isEmpty ())
+        {
+            z = polygon.first ().z ();
+        }
+        rings.append (toIntRing (polygon));
+    }
+    resize (kept);
+
+    const IntRings offsetted (offsetRings (rings, distance * planarScale, join, miterLimit, planarArcTolerance));
+    reserve (kept + offsetted.count ());
+    for (const IntRing &ring : offsetted)
+    {
+        append (toPolygon (ring, z, Polygon::Contour));
+    }
+}
+
+Layer Layer::offsetted(qreal distance, Polygon::JoinType join, qreal miterLimit) const &
 {
     Layer other (*this);
-    other.optimize (reference);
+    other.offset (distance, join, miterLimit);
     return other;
 }
 
-const Point Layer::optimize(Layer::SortPattern pattern, const Point &reference)
+Layer Layer::offsetted(qreal distance, Polygon::JoinType join, qreal miterLimit) &&
 {
-    sort (pattern);
+    offset (distance, join, miterLimit);
+    return std::move (*this);
+}
 
-    Point last = reference;
+/**
+ * @brief 取出 layer 中顶点数不少于 3 的 Contour 多边形
+ * @param z 若 rings 原为空且找到了 Contour 多边形, 返回第一个 Contour 多边形的 z 坐标
+ */
+static void contourRings (const Layer &layer, IntRings &rings, qreal &z)
+{
+    for (const Polygon &polygon : layer)
+    {
+        if (polygon.type () != Polygon::Contour || polygon.count () < 3)
+        {
+            continue;
+        }
+        if (rings.isEmpty ())
+        {
+            z = polygon.first ().z ();
+        }
+        rings.append (toIntRing (polygon));
+    }
+}
 
-    Layer flatterned [Polygon::PolygonTypeCount];
-    for (const Polygon &polygon : *this)
+/**
+ * @brief 对 layer 与 other 的 Contour 多边形按奇偶规则围成的区域做布尔运算
+ *
+ * 结果保留 layer 的厚度, 高度与非 Contour 多边形, 新的轮廓追加在层末尾,
+ * 外环逆时针, 孔洞顺时针, 均已闭合, z 坐标取 layer 的第一个 Contour 多边形, layer 无轮廓时取 other 的.
+ */
+static const Layer clipLayer (const Layer &layer, const Layer &other, ClipOperation operation)
+{
+    Layer result;
+    result.setThickness (layer.thickness ());
+    result.setHeight (layer.height ());
+    for (const Polygon &polygon : layer)
     {
-        int p (priority (pattern, polygon.type ()));
-        flatterned [p].append (polygon);
+        if (polygon.type () != Polygon::Contour)
+        {
+            result.append (polygon);
+        }
     }
 
-    clear ();
+    IntRings subject;
+    IntRings clip;
+    qreal z (0.0);
+    qreal otherZ (0.0);
+    contourRings (layer, subject, z);
+    contourRings (other, clip, otherZ);
+    if (subject.isEmpty ())
+    {
+        z = otherZ;
+    }
 
-    for (int i = 0; i < Polygon::PolygonTypeCount; ++i)
+    const IntRings rings (clipRings (subject, clip, operation));
+    result.reserve (result.count () + rings.count ());
+    for (const IntRing &ring : rings)
     {
-        Layer &layer = flatterned[i];
-        last = layer.optimize (last);
-        append (layer);
+        result.append (toPolygon (ring, z, Polygon::Contour));
     }
-    return last;
+    return result;
 }
 
-const Layer Layer::optimized(Layer::SortPattern pattern, const Point &reference) const
+Layer Layer::united(const Layer &other) const
 {
-    Layer other (*this);
-    other.optimize (pattern, reference);
+    return clipLayer (*this, other, UnionClip);
+}
+
+/**
+ * @brief 求多个层的 Contour 多边形所围区域的并集
+ *
+ * 每个层的轮廓各自按奇偶规则围成一个区域, 所有区域在一遍扫描中合并, 适合一次合并大量零件.
+ * 结果取第一个层的厚度与高度, 保留各层的非 Contour 多边形.
+ */
+Layer Layer::united(const QVector<Layer> &layers)
+{
+    Layer result;
+    if (! layers.isEmpty ())
+    {
+        result.setThickness (layers.first ().thickness ());
+        result.setHeight (layers.first ().height ());
+    }
+
+    QVector<IntRings> regions;
+    regions.reserve (layers.count ());
+    qreal z (0.0);
+    bool found (false);
+    for (const Layer &layer : layers)
+    {
+        IntRings rings;
+        qreal layerZ (0.0);
+        contourRings (layer, rings, layerZ);
+        if (! rings.isEmpty ())
+        {
+            if (! found)
+            {
+                z = layerZ;
+                found = true;
+            }
+            regions.append (rings);
+        }
+
+        for (const Polygon &polygon : layer)
+        {
+            if (polygon.type () != Polygon::Contour)
+            {
+                result.append (polygon);
+            }
+        }
+    }
+
+    const IntRings rings (uniteRegions (regions));
+    result.reserve (result.count () + rings.count ());
+    for (const IntRing &ring : rings)
+    {
+        result.append (toPolygon (ring, z, Polygon::Contour));
+    }
+    return result;
+}
+
+Layer Layer::intersected(const Layer &other) const
+{
+    return clipLayer (*this, other, IntersectionClip);
+}
+
+Layer Layer::subtracted(const Layer &other) const
+{
+    return clipLayer (*this, other, DifferenceClip);
+}
+
+Layer Layer::xored(const Layer &other) const
+{
+    return clipLayer (*this, other, XorClip);
+}
+
+/**
+ * @brief 生成 Contour 多边形所围区域的填充线
+ *
+ * 孔洞按奇偶规则处理. Line 生成同向的填充线, Zigzag 生成相邻方向相反的填充线,
+ * ZigzagContinuous 将相邻的填充线沿边界连成折线, spec.angle 为填充线与 x 轴的夹角, 单位为度.
+ * Concentric 生成间距为 spec.interval 的同心环, 按行程排序, 同一块区域由外向内.
+ * 轮廓内侧依次生成 spec.extraContourCount 圈间距为 spec.extraContourWidth 的 Extra 轮廓,
+ * 填充区域为最内圈再向内收缩 spec.shrinkWidth.
+ * @return 仅含生成的 Extra 与 Infill 多边形的层, 厚度与高度同本层
+ */
+Layer Layer::infill(const InfillSpec &spec) const
+{
+    Layer other;
+    other.setThickness (m_thickness);
+    other.setHeight (m_height);
+    fillLayer (*this, spec, other);
     return other;
 }
 
+/**
+ * @brief 将 infill (spec) 生成的填充线追加到本层
+ */
+void Layer::fill(const InfillSpec &spec)
+{
+    append (infill (spec));
+}
+
 void Layer::filter(Polygon::PolygonType type)
 {
     for (int i = count (); i >= 0; --i)
@@ -281,7 +927,7 @@ void Layer::filter(Polygon::PolygonType type)
     }
 }
 
-const Layer Layer::filtered(Polygon::PolygonType type) const
+Layer Layer::filtered(Polygon::PolygonType type) const
 {
     Layer other (*this);
     other.filter (type);
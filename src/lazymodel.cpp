@@ -0,0 +1,205 @@
+﻿#include "lazymodel.h"
+#include "heightindex.h"
+#include <QFileInfo>
+#include <QMutexLocker>
+
+static const int DefaultCacheSize = 16;
+
+LazyModel::LazyModel () :
+    m_cache (DefaultCacheSize)
+{}
+
+LazyModel::~LazyModel ()
+{
+    close ();
+}
+
+bool LazyModel::open (const QString &filename)
+{
+    close ();
+
+    bool ok (false);
+    do
+    {
+        if (filename.isEmpty ())
+        {
+            break;
+        }
+
+        m_name = QFileInfo (filename).baseName ();
+
+        if (! m_reader.open (filename))
+        {
+            break;
+        }
+
+        m_records = m_reader.scan ();
+
+        // same ordering as Model::sort
+        std::stable_sort (m_records.begin (),
+                          m_records.end (),
+                          [] (const SLCReader::LayerRecord &a, const SLCReader::LayerRecord &b)
+                          {
+                              return (a.height < b.height);
+                          });
+
+        m_heights.reserve (m_records.count ());
+        for (const SLCReader::LayerRecord &record : m_records)
+        {
+            m_heights.append (record.height);
+        }
+
+        ok = true;
+    }
+    while (false);
+    return ok;
+}
+
+void LazyModel::close ()
+{
+    QMutexLocker locker (&m_mutex);
+    m_cache.clear ();
+    m_boundary = Boundary ();
+    m_boundaryValid = false;
+
+    m_records.clear ();
+    m_heights.clear ();
+    m_name.clear ();
+    m_reader.close ();
+}
+
+bool LazyModel::isOpen () const
+{
+    return m_reader.isOpen ();
+}
+
+int LazyModel::count () const
+{
+    return m_records.count ();
+}
+
+bool LazyModel::isEmpty () const
+{
+    return m_records.isEmpty ();
+}
+
+const Boundary LazyModel::boundary () const
+{
+    QMutexLocker locker (&m_mutex);
+    if (! m_boundaryValid)
+    {
+        // decode every layer once through a scratch layer, bypassing the cache
+        Layer layer;
+        for (const SLCReader::LayerRecord &record : m_records)
+        {
+            qint64 offset (record.offset);
+            if (m_reader.readLayer (offset, layer))
+            {
+                m_boundary.refer (layer.boundary ());
+            }
+        }
+        m_boundaryValid = true;
+    }
+    return m_boundary;
+}
+
+const Point LazyModel::center () const
+{
+    return boundary ().center ();
+}
+
+const Point LazyModel::dimension () const
+{
+    return boundary ().dimension ();
+}
+
+const QList<qreal> LazyModel::heights () const
+{
+    return m_heights;
+}
+
+/**
+ * @return 下标越界或该层解码失败时返回空层, 解码失败的层不进入缓存
+ */
+const Layer LazyModel::at (int index) const
+{
+    if (index < 0 || index >= count ())
+    {
+        return Layer ();
+    }
+
+    QMutexLocker locker (&m_mutex);
+    Layer *cached (m_cache.object (index));
+    if (cached != nullptr)
+    {
+        return *cached;
+    }
+
+    Layer *layer (new Layer);
+    qint64 offset (m_records.at (index).offset);
+    if (! m_reader.readLayer (offset, *layer))
+    {
+        delete layer;
+        return Layer ();
+    }
+
+    Layer result (*layer);
+    m_cache.insert (index, layer);
+    return result;
+}
+
+const Layer LazyModel::layerAtHeight (const qreal height, Model::HeightMatch match, const qreal tolerance) const
+{
+    return at (indexOfHeight (height, match, tolerance));
+}
+
+int LazyModel::indexOfHeight (const qreal height, Model::HeightMatch match, const qreal tolerance) const
+{
+    return searchHeight (m_heights, height, match, tolerance);
+}
+
+qreal LazyModel::contourStartHeight () const
+{
+    qreal startHeight (NAN);
+    int index (contourStartIndex ());
+    if (index >= 0)
+    {
+        startHeight = m_heights.at (index);
+    }
+    return startHeight;
+}
+
+int LazyModel::contourStartIndex () const
+{
+    int index (-1);
+
+    // all polygons of a SLC file share the type given by its header
+    if (m_reader.polygonType () != Polygon::Support)
+    {
+        for (int i = 0; i < m_records.count (); ++i)
+        {
+            if (m_records.at (i).polygonCount > 0)
+            {
+                index = i;
+                break;
+            }
+        }
+    }
+    return index;
+}
+
+void LazyModel::setCacheSize (int layerCount)
+{
+    QMutexLocker locker (&m_mutex);
+    m_cache.setMaxCost (qMax (layerCount, 0));
+}
+
+int LazyModel::cacheSize () const
+{
+    return m_cache.maxCost ();
+}
+
+const QString LazyModel::name () const
+{
+    return m_name;
+}
@@ -1,7 +1,17 @@
 ﻿#include "model.h"
+#include "heightindex.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "profiling.h"
+#include "slcreader.h"
+#include "slcwriter.h"
+#include "xlcformat.h"
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QDataStream>
+#include <algorithm>
+#include <functional>
 
 #ifdef USE_COMPRESSION
 #include "kcompressiondevice.h"
@@ -9,12 +19,16 @@
 
 const Boundary Model::boundary() const
 {
-    Boundary boundary;
+    qreal lower [3] = {INFINITY, INFINITY, INFINITY};
+    qreal upper [3] = {-INFINITY, -INFINITY, -INFINITY};
     for (const Layer &layer : *this)
     {
-        boundary.refer (layer.boundary ());
+        for (const Polygon &polygon : layer)
+        {
+            boundaryKernel (polygon.constData (), polygon.count (), lower, upper);
+        }
     }
-    return boundary;
+    return kernelBoundary (lower, upper);
 }
 
 const Point Model::center() const
@@ -32,18 +46,47 @@ const QList<qreal> Model::heights() const
     return m_heights;
 }
 
-const Layer Model::at (int index) const
+/**
+ * @brief 第 index 层的引用, 与 constAt () 相同
+ * @return 下标越界时返回一个空层
+ */
+const Layer &Model::at (int index) const
+{
+    return constAt (index);
+}
+
+const Layer &Model::layerAtHeight(const qreal height, HeightMatch match, const qreal tolerance) const
+{
+    return constAt (indexOfHeight (height, match, tolerance));
+}
+
+/**
+ * @brief 第 index 层的引用
+ * @return 下标越界时返回一个空层
+ */
+const Layer &Model::constAt (int index) const
 {
+    static const Layer empty;
     if (index >= 0 && index < count ())
         return QVector::at (index);
     else
-        return Layer ();
+        return empty;
 }
 
-const Layer Model::layerAtHeight(const qreal height) const
+const Layer &Model::constLayerAtHeight(const qreal height, HeightMatch match, const qreal tolerance) const
 {
-    int index = m_heights.indexOf (height);
-    return at (index);
+    return constAt (indexOfHeight (height, match, tolerance));
+}
+
+/**
+ * @brief 在高度表中二分查找, 要求模型已经 sort ()
+ * @param match ExactHeight 只接受 tolerance 内的高度, NearestHeight 取最近的层,
+ * FloorHeight 与 CeilHeight 分别取不高于与不低于 height 的最近层 (均计入 tolerance, 含边界)
+ * @return 层的下标, 无匹配时返回 -1
+ */
+int Model::indexOfHeight(const qreal height, HeightMatch match, const qreal tolerance) const
+{
+    return searchHeight (m_heights, height, match, tolerance);
 }
 
 qreal Model::contourStartHeight() const
@@ -86,38 +129,217 @@ int Model::contourStartIndex() const
 
 void Model::sort()
 {
-    m_heights.clear ();
+    SLCKIT_PROFILE_SCOPE ("Model::sort");
     std::stable_sort (this->begin (), this->end ());
+    updateHeights ();
+}
 
+void Model::updateHeights()
+{
+    m_heights.clear ();
+    m_heights.reserve (count ());
     for (const Layer &layer : *this)
     {
         m_heights.append (layer.height ());
     }
 }
 
-void Model::merge(const Model &other)
+/**
+ * @brief 合并若干已按高度排序的层序列, 各序列中的层被移出
+ *
+ * 以各序列的当前层组成小顶堆做一遍多路归并. 每次取最低的层为一组,
+ * 其它序列中高度不超出其 tolerance 的当前层并入该组, 每个序列每组至多出一层,
+ * 高度相同时序号小的序列在前. 组内以第一层的厚度与高度为准.
+ */
+static const QVector<Layer> mergeSorted (QVector<QVector<Layer>> &inputs, Model::MergeMode mode, const qreal tolerance)
 {
-    sort ();
+    SLCKIT_PROFILE_SCOPE ("Model::merge");
+    class Head
+    {
+    public:
+        qreal height;
+        int input;
+    };
+
+    // std::push_heap builds a max-heap, so the order is reversed to keep the lowest layer on top
+    const auto later = [] (const Head &a, const Head &b)
+    {
+        return (a.height > b.height || (a.height == b.height && a.input > b.input));
+    };
+
+    QVector<Layer> merged;
+    QVector<int> positions (inputs.count (), 0);
+    QVector<Head> heap;
+    int total (0);
+    for (int i = 0; i < inputs.count (); ++i)
+    {
+        total += inputs.at (i).count ();
+        if (! inputs.at (i).isEmpty ())
+        {
+            heap.append (Head {inputs.at (i).first ().height (), i});
+        }
+    }
+    std::make_heap (heap.begin (), heap.end (), later);
+    merged.reserve (total);
 
-    for (const Layer &layer : other)
+    QVector<int> group;
+    QVector<Layer> layers;
+    while (! heap.isEmpty ())
     {
-        qreal height = layer.height ();
-        if (m_heights.contains (height))
+        group.clear ();
+        const qreal lowest (heap.first ().height);
+        while (! heap.isEmpty () && heap.first ().height <= lowest + tolerance)
+        {
+            std::pop_heap (heap.begin (), heap.end (), later);
+            group.append (heap.last ().input);
+            heap.removeLast ();
+        }
+
+        layers.clear ();
+        for (int input : group)
+        {
+            QVector<Layer> &source (inputs [input]);
+            layers.append (std::move (source [positions.at (input)]));
+            if (++positions [input] < source.count ())
+            {
+                heap.append (Head {source.at (positions.at (input)).height (), input});
+                std::push_heap (heap.begin (), heap.end (), later);
+            }
+        }
+
+        if (layers.count () == 1)
         {
-            int index = m_heights.indexOf (height);
-            operator [] (index) += layer;
+            merged.append (std::move (layers.first ()));
+        }
+        else if (mode == Model::UniteContours)
+        {
+            merged.append (Layer::united (layers));
         }
         else
         {
-            append (layer);
+            Layer layer (std::move (layers.first ()));
+            for (int i = 1; i < layers.count (); ++i)
+            {
+                layer += layers.at (i);
+            }
+            merged.append (std::move (layer));
         }
     }
+    return merged;
+}
+
+/**
+ * @brief 将 other 的各层并入本模型, 高度相差不超过 tolerance 的层合为一层
+ *
+ * ConcatenateContours 直接拼接两层的多边形, UniteContours 将两层轮廓所围区域求并,
+ * 使重叠的零件只留下外轮廓, 其它类型的多边形仍直接拼接.
+ * 两个模型按高度排序后一遍归并. 合并后的层取容差组中最低一层的高度与厚度,
+ * 该层不一定来自本模型; 高度相同时以本模型的层为准.
+ */
+void Model::merge(const Model &other, MergeMode mode, const qreal tolerance)
+{
+    merge (Model (other), mode, tolerance);
+}
+
+/**
+ * @brief 与 merge (const Model &, MergeMode, qreal) 相同, 但直接移入 other 的层
+ */
+void Model::merge(Model &&other, MergeMode mode, const qreal tolerance)
+{
+    if (! std::is_sorted (begin (), end ()))
+    {
+        std::stable_sort (begin (), end ());
+    }
+    if (! std::is_sorted (other.begin (), other.end ()))
+    {
+        std::stable_sort (other.begin (), other.end ());
+    }
+
+    QVector<QVector<Layer>> inputs;
+    inputs.reserve (2);
+    inputs.append (std::move (static_cast<QVector<Layer> &> (*this)));
+    inputs.append (std::move (static_cast<QVector<Layer> &> (other)));
+    QVector<Layer>::operator = (mergeSorted (inputs, mode, tolerance));
+    updateHeights ();
+}
+
+/**
+ * @brief 一次合并多个模型, 如拼版时各零件的模型
+ *
+ * 所有模型只归并一遍, UniteContours 时同一组的轮廓也只求一次并集. 容差分组在所有模型的层上一起进行,
+ * 组的高度取组内最低的层, 而逐个 merge 时每次都以已合并的层高为准再分组, 因此 tolerance 大于 0 时
+ * 两者的分组可能不同. tolerance 为 0 时各层的多边形与逐个 merge 相同, UniteContours 时所围区域相同.
+ * 合并后的模型取第一个模型的名称.
+ */
+Model Model::merged(QVector<Model> models, MergeMode mode, const qreal tolerance)
+{
+    Model model;
+    QVector<QVector<Layer>> inputs;
+    inputs.reserve (models.count ());
+    for (Model &other : models)
+    {
+        if (! std::is_sorted (other.begin (), other.end ()))
+        {
+            std::stable_sort (other.begin (), other.end ());
+        }
+        inputs.append (std::move (static_cast<QVector<Layer> &> (other)));
+    }
+    if (! models.isEmpty ())
+    {
+        model.setName (models.first ().name ());
+    }
+
+    model.QVector<Layer>::operator = (mergeSorted (inputs, mode, tolerance));
+    model.updateHeights ();
+    return model;
+}
+
+static const Model readMappedSLC (const QString &filename)
+{
+    SLCKIT_PROFILE_SCOPE ("Model::readSLC");
+    Model model;
+    do
+    {
+        if (filename.isEmpty ())
+        {
+            break;
+        }
+
+        model.setName (QFileInfo (filename).baseName ());
+
+        SLCReader reader;
+        if (! reader.open (filename))
+        {
+            break;
+        }
+
+        qint64 offset (reader.contourOffset ());
+        while (true)
+        {
+            Layer layer;
+            if (! reader.readLayer (offset, layer))
+            {
+                break;
+            }
+            model.append (layer);
+        }
+        reader.close ();
 
-    sort ();
+        model.sort ();
+    }
+    while (false);
+    return model;
 }
 
-const Model Model::readSLC(const QString &filename)
+Model Model::readSLC(const QString &filename, SLCReadMode mode)
 {
+    if (mode == MappedRead)
+    {
+        return readMappedSLC (filename);
+    }
+
+    SLCKIT_PROFILE_SCOPE ("Model::readSLC");
+
     bool ok (false);
     Model model;
     do
@@ -279,6 +501,7 @@ const Model Model::readSLC(const QString &filename)
                     Point point(verticeX * unitScale, verticsY * unitScale);
                     polygon.append( point );
                 }
+                SLCKIT_PROFILE_COUNT (Vertices, numberOfVertices);
 
                 if (isPart)
                 {
@@ -293,7 +516,11 @@ const Model Model::readSLC(const QString &filename)
             }
             layer.setHeight (minZlevel * unitScale);
             model.append(layer);
+            SLCKIT_PROFILE_COUNT (Layers, 1);
+            SLCKIT_PROFILE_COUNT (Polygons, numberOfBoundary);
+            SLCKIT_PROFILE_COUNT (Allocations, numberOfBoundary + 1);
         }
+        SLCKIT_PROFILE_COUNT (BytesRead, slcFile.pos ());
         slcFile.close();
 
         model.sort ();
@@ -302,6 +529,108 @@ const Model Model::readSLC(const QString &filename)
     return model;
 }
 
+/**
+ * @brief 多线程读取 SLC 文件
+ *
+ * 先扫描一遍轮廓数据段记录各层的偏移, 再由 threadCount 个线程并行解码各层,
+ * 结果与单线程读取完全一致: 某层解码失败时只保留文件中位于它之前的层.
+ * @param threadCount 线程数, 小于等于 0 时使用 QThread::idealThreadCount ()
+ */
+Model Model::readSLC(const QString &filename, int threadCount)
+{
+    SLCKIT_PROFILE_SCOPE ("Model::readSLC");
+
+    Model model;
+    do
+    {
+        if (filename.isEmpty ())
+        {
+            break;
+        }
+
+        model.setName (QFileInfo (filename).baseName ());
+
+        SLCReader reader;
+        if (! reader.open (filename))
+        {
+            break;
+        }
+
+        const QVector<SLCReader::LayerRecord> records (reader.scan ());
+
+        model.resize (records.count ());
+        Layer *layers (model.data ());
+        QVector<char> decoded (records.count (), 0);
+        char *flags (decoded.data ());
+
+        parallelFor (records.count (), threadCount, [&] (int index)
+        {
+            qint64 offset (records.at (index).offset);
+            flags [index] = reader.readLayer (offset, layers [index]) ? 1 : 0;
+        });
+        reader.close ();
+
+        // like the serial reader, keep the layers in front of the first one that failed
+        const int failed (decoded.indexOf (0));
+        if (failed >= 0)
+        {
+            model.resize (failed);
+        }
+
+        model.sort ();
+    }
+    while (false);
+    return model;
+}
+
+/**
+ * @brief 按层的顺序保存为 SLC 2.0 文件
+ *
+ * SLC 不区分多边形类型, 所有多边形均写出, 文件类型由 type 决定.
+ * 采样表的层厚取第一层的厚度, 未设置时取前两层的高度差.
+ */
+bool Model::saveSLC(const QString &filename, Polygon::PolygonType type) const
+{
+    SLCKIT_PROFILE_SCOPE ("Model::saveSLC");
+
+    bool ok (false);
+    do
+    {
+        SLCWriter::Header header;
+        header.type = type;
+        header.extents = boundary ();
+        if (! isEmpty ())
+        {
+            header.minZ = constFirst ().height ();
+            header.thickness = constFirst ().thickness ();
+            if (fuzzyIsNull (header.thickness) && count () > 1)
+            {
+                header.thickness = constAt (1).height () - header.minZ;
+            }
+        }
+
+        SLCWriter writer;
+        if (! writer.open (filename, header))
+        {
+            break;
+        }
+
+        bool written (true);
+        for (const Layer &layer : *this)
+        {
+            if (! writer.writeLayer (layer))
+            {
+                written = false;
+                break;
+            }
+        }
+
+        ok = (writer.close () && written);
+    }
+    while (false);
+    return ok;
+}
+
 void Model::translate(const Point &offset)
 {
     for (Layer &layer : *this)
@@ -310,18 +639,234 @@ void Model::translate(const Point &offset)
     }
 }
 
-const Model Model::translated(const Point &offset) const
+Model Model::translated(const Point &offset) const &
 {
     Model other (*this);
     other.translate (offset);
     return other;
 }
 
-const Model Model::readXLC(const QString &filename)
+/**
+ * @brief 右值版本, 原地平移各层后移出本模型, 如 Model::readSLC (...).translated (offset)
+ */
+Model Model::translated(const Point &offset) &&
+{
+    translate (offset);
+    return std::move (*this);
+}
+
+/**
+ * @brief 对 layers 中每一层执行 optimize, 各层互不依赖时直接并行
+ *
+ * chained 时每层的起点是前一层的终点. 贪心排序只在决定首个非空多边形
+ * (leading 给出) 是否反向时用到起点, 因此每层只有两种可能的结果:
+ * 先并行算出两种结果及其终点, 再按层序依次选择, 结果与逐层串行优化完全一致.
+ * 反向结果需要复制整层, 因此按窗口分批处理, 同一时刻最多保留 16 * threadCount 层的副本.
+ */
+static const Point optimizeLayers (Layer *layers,
+                                   int count,
+                                   const Point &reference,
+                                   bool chained,
+                                   int threadCount,
+                                   const std::function<const Point (Layer &layer, const Point &reference)> &optimize,
+                                   const std::function<const Polygon *(const Layer &layer)> &leading)
+{
+    SLCKIT_PROFILE_SCOPE ("Model::optimize");
+
+    if (count <= 0)
+    {
+        return reference;
+    }
+
+    if (! chained)
+    {
+        QVector<Point> ends (count);
+        parallelFor (count, threadCount, [&] (int index)
+        {
+            ends [index] = optimize (layers [index], reference);
+        });
+        return ends.last ();
+    }
+
+    // the reversed copies only live until their window has been chained, which bounds
+    // the extra memory by the window instead of the whole model
+    if (threadCount <= 0)
+    {
+        threadCount = QThread::idealThreadCount ();
+    }
+    const int window (std::min (count, std::max (threadCount, 1) * 16));
+
+    QVector<Point> forwardEnds (window), reversedEnds (window);
+    QVector<Point> leadFirsts (window), leadLasts (window);
+    QVector<bool> hasLead (window);
+    QVector<Layer> reversedLayers (window);
+
+    Point last = reference;
+    for (int begin = 0; begin < count; begin += window)
+    {
+        const int size (std::min (window, count - begin));
+        hasLead.fill (false);
+
+        parallelFor (size, threadCount, [&] (int slot)
+        {
+            Layer &layer (layers [begin + slot]);
+            const Polygon *lead (leading (layer));
+            if (lead == nullptr)
+            {
+                optimize (layer, reference);
+                return;
+            }
+
+            hasLead [slot] = true;
+            leadFirsts [slot] = lead->first ();
+            leadLasts [slot] = lead->last ();
+
+            // starting exactly at one end of the leading polygon selects its orientation
+            if (leadFirsts.at (slot).distance2D (leadLasts.at (slot)) > 0.0)
+            {
+                reversedLayers [slot] = layer;
+                reversedEnds [slot] = optimize (reversedLayers [slot], leadLasts.at (slot));
+            }
+            forwardEnds [slot] = optimize (layer, leadFirsts.at (slot));
+        });
+
+        for (int slot = 0; slot < size; ++slot)
+        {
+            if (! hasLead.at (slot))
+            {
+                continue;
+            }
+
+            // the same test as the first step of Layer::optimize
+            if (leadFirsts.at (slot).distance2D (last) > leadLasts.at (slot).distance2D (last) &&
+                leadFirsts.at (slot).distance2D (leadLasts.at (slot)) > 0.0)
+            {
+                std::swap (layers [begin + slot], reversedLayers [slot]);
+                last = reversedEnds.at (slot);
+            }
+            else
+            {
+                last = forwardEnds.at (slot);
+            }
+            reversedLayers [slot] = Layer ();
+        }
+    }
+    return last;
+}
+
+static const Polygon *firstNonEmpty (const Layer &layer)
 {
+    for (const Polygon &polygon : layer)
+    {
+        if (! polygon.isEmpty ())
+        {
+            return &polygon;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 在 threadCount 个线程上对每一层执行 Layer::optimize
+ * @param chained 为 true 时每层以前一层的终点为起点, 否则各层均以 reference 为起点.
+ *        此时每层最多优化两次, 并临时复制至多 16 * threadCount 层
+ * @param threadCount 线程数, 小于等于 0 时使用 QThread::idealThreadCount ().
+ *        每次调用 (chained 时每个窗口) 都会新建线程, 层数很少时宜传 1
+ * @return 最后一层的终点
+ */
+const Point Model::optimize(const Point &reference, bool chained, int threadCount)
+{
+    return optimizeLayers (data (),
+                           count (),
+                           reference,
+                           chained,
+                           threadCount,
+                           [] (Layer &layer, const Point &start) { return layer.optimize (start); },
+                           [] (const Layer &layer) { return firstNonEmpty (layer); });
+}
+
+/**
+ * @brief 与 optimize (const Point &, bool, int) 相同, 但各层执行 Layer::optimize (SortPattern, ...)
+ */
+const Point Model::optimize(Layer::SortPattern pattern, const Point &reference, bool chained, int threadCount)
+{
+    // the leading polygon is looked up after the same stable sort optimize (pattern) starts with
+    Layer *layers (data ());
+    parallelFor (count (), threadCount, [layers, pattern] (int index)
+    {
+        layers [index].sort (pattern);
+    });
+
+    return optimizeLayers (layers,
+                           count (),
+                           reference,
+                           chained,
+                           threadCount,
+                           [pattern] (Layer &layer, const Point &start) { return layer.optimize (pattern, start); },
+                           [] (const Layer &layer) { return firstNonEmpty (layer); });
+}
+
+/**
+ * @brief 返回 optimize (reference, chained, threadCount) 之后的模型, 终点不再返回
+ */
+Model Model::optimized(const Point &reference, bool chained, int threadCount) const &
+{
+    Model other (*this);
+    other.optimize (reference, chained, threadCount);
+    return other;
+}
+
+Model Model::optimized(const Point &reference, bool chained, int threadCount) &&
+{
+    optimize (reference, chained, threadCount);
+    return std::move (*this);
+}
+
+Model Model::optimized(Layer::SortPattern pattern, const Point &reference, bool chained, int threadCount) const &
+{
+    Model other (*this);
+    other.optimize (pattern, reference, chained, threadCount);
+    return other;
+}
+
+Model Model::optimized(Layer::SortPattern pattern, const Point &reference, bool chained, int threadCount) &&
+{
+    optimize (pattern, reference, chained, threadCount);
+    return std::move (*this);
+}
+
+/**
+ * @brief 读取 XLC 文件, 支持 v3.0 与 v2.0
+ *
+ * v3.0 文件经内存映射按层目录并行解码 (含逐层解压), v2.0 文件仍以 QDataStream 顺序读取.
+ */
+Model Model::readXLC(const QString &filename)
+{
+    SLCKIT_PROFILE_SCOPE ("Model::readXLC");
+
     Model model;
     do
     {
+        XLCReader reader;
+        if (reader.open (filename))
+        {
+            model.setName (reader.name ());
+            model.resize (reader.count ());
+            Layer *layers (model.data ());
+            QVector<char> decoded (reader.count (), 0);
+            char *flags (decoded.data ());
+            parallelFor (reader.count (), 0, [&reader, layers, flags] (int index)
+            {
+                flags [index] = reader.readLayer (index, layers [index]) ? 1 : 0;
+            });
+
+            if (decoded.contains (0))
+            {
+                model.clear ();
+            }
+            model.sort ();
+            break;
+        }
 
 #ifdef USE_COMPRESSION
         KCompressionDevice device (filename, KCompressionDevice::CompressionType::GZip);
@@ -345,6 +890,7 @@ const Model Model::readXLC(const QString &filename)
         }
 
         stream >> model;
+        SLCKIT_PROFILE_COUNT (BytesRead, device.pos ());
 
         device.close ();
     }
@@ -352,36 +898,59 @@ const Model Model::readXLC(const QString &filename)
     return model;
 }
 
-bool Model::saveXLC(const QString &filename) const
+/**
+ * @brief 保存为 XLC v3.0 文件
+ *
+ * 文件头之后是记录各层高度, 偏移, 长度与包围盒的层目录, 各层坐标以 float 连续存放,
+ * 每层所有顶点共用同一个 z 坐标, 取该层第一个顶点的 z.
+ * 为保持各层可直接定位读取, v3.0 文件不做整体压缩, 而是按 compression 逐层压缩,
+ * 每层可单独解压. 不压缩时坐标块可直接映射整块复制.
+ * 各层在 threadCount 个线程中并行编码压缩, 由调用线程按顺序写出. 文件经 QSaveFile 写入,
+ * 失败或被中止时原有文件保持不变.
+ * @param threadCount 线程数, 小于等于 0 时使用 QThread::idealThreadCount ()
+ * @param progress 每写出一批层后以已写出的层数与总层数调用, 返回 false 时中止保存, 可为空
+ * @return 写入失败, 被中止, 本库编译时未启用 compression 或某一层的数据块超过 2 GB 时返回 false
+ */
+bool Model::saveXLC(const QString &filename,
+                    XLCCompression compression,
+                    int threadCount,
+                    const std::function<bool (int written, int count)> &progress) const
 {
+    SLCKIT_PROFILE_SCOPE ("Model::saveXLC");
+
     bool ok (false);
     do
     {
+        if (! isCompressionSupported (compression))
+        {
+            break;
+        }
 
-#ifdef USE_COMPRESSION
-        KCompressionDevice device (filename, KCompressionDevice::CompressionType::GZip);
-#else
-        QFile device (filename);
-#endif
-
+        QSaveFile device (filename);
         if (! device.open (QIODevice::WriteOnly))
         {
             break;
         }
 
-        QDataStream stream (&device);
-        stream << QStringLiteral ("XLC v2.0");
-
-        stream << (*this);
-
-        device.close ();
+        if (! writeXLC (device, name (), constData (), count (), compression, threadCount, progress))
+        {
+            break;
+        }
 
-        ok = true;
+        ok = device.commit ();
     }
     while (false);
     return ok;
 }
 
+/**
+ * @brief 本库编译时是否启用了 compression, 由 CMake 选项 SLCKIT_USE_LZ4 与 SLCKIT_USE_ZSTD 控制
+ */
+bool Model::isCompressionSupported(XLCCompression compression)
+{
+    return xlcIsSupported (compression);
+}
+
 const QString Model::name() const
 {
     return m_name;
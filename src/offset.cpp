@@ -0,0 +1,141 @@
+﻿#include "planar.h"
+#include <cmath>
+
+// Each ring of the normalized region (inside on the left) is replaced by its
+// edges moved by delta to the right, i.e. away from the inside. Where the
+// moved edges open a gap the vertex gets a miter, bevel or round join; where
+// they overlap the original vertex is inserted between them, which leaves
+// small loops of non-positive winding. A union with the positive fill rule
+// removes these loops, the overlaps and the collapsed rings.
+
+namespace
+{
+
+class Vector
+{
+public:
+    qreal x;
+    qreal y;
+};
+
+inline IntPoint shifted (const IntPoint &p, qreal dx, qreal dy)
+{
+    return IntPoint {p.x + qint64 (std::llround (dx)), p.y + qint64 (std::llround (dy))};
+}
+
+void offsetRing (const IntRing &ring,
+                 qreal delta,
+                 Polygon::JoinType join,
+                 qreal miterLimit,
+                 qreal arcTolerance,
+                 IntRing &output)
+{
+    const int count (ring.count ());
+    QVector<Vector> normals (count);
+    for (int i = 0; i < count; ++i)
+    {
+        const IntPoint &a (ring.at (i));
+        const IntPoint &b (ring.at ((i + 1) % count));
+        const qreal dx (qreal (b.x - a.x));
+        const qreal dy (qreal (b.y - a.y));
+        const qreal length (std::sqrt (dx * dx + dy * dy));
+        normals [i] = Vector {dy / length, -dx / length};
+    }
+
+    // the round join follows the polygon circumscribing the arc, whose vertices stay within
+    // arcTolerance of the arc; a small turn is then a single miter point, so repeated offsets
+    // do not multiply the vertices
+    const qreal radius (std::abs (delta));
+    const qreal step (arcTolerance > 0.0 ?
+                      2.0 * std::acos (radius / (radius + arcTolerance)) :
+                      PI / 4.0);
+
+    output.clear ();
+    output.reserve (count * 2);
+    for (int i = 0; i < count; ++i)
+    {
+        const IntPoint &p (ring.at (i));
+        const Vector &n1 (normals.at ((i + count - 1) % count));
+        const Vector &n2 (normals.at (i));
+        const qreal sinA (n1.x * n2.y - n1.y * n2.x);
+        const qreal cosA (n1.x * n2.x + n1.y * n2.y);
+
+        if (std::abs (sinA) < 1e-12 && cosA > 0.0)
+        {
+            output.append (shifted (p, n2.x * delta, n2.y * delta));
+            continue;
+        }
+
+        if (sinA * delta < 0.0)
+        {
+            output.append (shifted (p, n1.x * delta, n1.y * delta));
+            output.append (p);
+            output.append (shifted (p, n2.x * delta, n2.y * delta));
+            continue;
+        }
+
+        switch (join)
+        {
+        case Polygon::MiterJoin:
+            // the miter reaches |delta| * sqrt (2 / (1 + cosA)) from the vertex
+            if (1.0 + cosA > 2.0 / (miterLimit * miterLimit))
+            {
+                const qreal scale (delta / (1.0 + cosA));
+                output.append (shifted (p, (n1.x + n2.x) * scale, (n1.y + n2.y) * scale));
+                break;
+            }
+            // fall through
+        case Polygon::BevelJoin:
+            output.append (shifted (p, n1.x * delta, n1.y * delta));
+            output.append (shifted (p, n2.x * delta, n2.y * delta));
+            break;
+        case Polygon::RoundJoin:
+        {
+            const qreal angle (std::atan2 (sinA, cosA));
+            const int steps (std::max (1, int (std::ceil (std::abs (angle) / std::min (step, PI / 2.0)))));
+            const qreal scale (delta / std::cos (0.5 * angle / steps));
+            for (int k = 0; k < steps; ++k)
+            {
+                const qreal t (angle * (k + 0.5) / steps);
+                const qreal c (std::cos (t));
+                const qreal s (std::sin (t));
+                output.append (shifted (p, (n1.x * c - n1.y * s) * scale, (n1.x * s + n1.y * c) * scale));
+            }
+            break;
+        }
+        }
+    }
+}
+
+}
+
+IntRings offsetRings (const IntRings &rings,
+                      qreal delta,
+                      Polygon::JoinType join,
+                      qreal miterLimit,
+                      qreal arcTolerance)
+{
+    return offsetRegion (resolveRings (rings, EvenOddFill), delta, join, miterLimit, arcTolerance);
+}
+
+IntRings offsetRegion (const IntRings &region,
+                       qreal delta,
+                       Polygon::JoinType join,
+                       qreal miterLimit,
+                       qreal arcTolerance)
+{
+    if (delta == 0.0)
+    {
+        return region;
+    }
+
+    IntRings raw;
+    raw.reserve (region.count ());
+    IntRing ring;
+    for (const IntRing &source : region)
+    {
+        offsetRing (source, delta, join, miterLimit, arcTolerance, ring);
+        raw.append (ring);
+    }
+    return resolveRings (raw, PositiveFill);
+}
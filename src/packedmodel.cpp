@@ -0,0 +1,459 @@
+﻿#include "packedmodel.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "profiling.h"
+#include "slcreader.h"
+#include "xlcreader.h"
+#include <QFileInfo>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// the arena is laid out as LayerRange [layerCount], PolygonRange [polygonCount], Point [vertexCount],
+// every part a multiple of 8 bytes so that the next one stays aligned
+static_assert (sizeof (PackedModel::LayerRange) % 8 == 0, "LayerRange must keep the arena aligned");
+static_assert (sizeof (PackedModel::PolygonRange) % 8 == 0, "PolygonRange must keep the arena aligned");
+
+// the kernels take an int count, larger arrays are passed in pieces
+static const qint64 KernelChunk = qint64 (1) << 30;
+
+static inline qint64 arenaSize (int layerCount, qint64 polygonCount, qint64 vertexCount)
+{
+    return qint64 (layerCount) * qint64 (sizeof (PackedModel::LayerRange)) +
+           polygonCount * qint64 (sizeof (PackedModel::PolygonRange)) +
+           vertexCount * qint64 (sizeof (Point));
+}
+
+PackedModel::PackedModel ()
+{}
+
+/**
+ * @brief 分配指定数量的层, 多边形与顶点
+ *
+ * 层表与多边形表清零, 顶点不初始化. 各层与多边形的区间及顶点由调用者填写,
+ * 如 SLCReader::readLayer (qint64 &, PackedModel &, int). 分配失败时为空模型, byteCount () 为 0.
+ */
+PackedModel::PackedModel (int layerCount, qint64 polygonCount, qint64 vertexCount)
+{
+    allocate (layerCount, polygonCount, vertexCount);
+}
+
+PackedModel::PackedModel (const Model &model) :
+    m_name (model.name ())
+{
+    qint64 polygonCount (0);
+    qint64 vertexCount (0);
+    for (const Layer &layer : model)
+    {
+        polygonCount += layer.count ();
+        for (const Polygon &polygon : layer)
+        {
+            vertexCount += polygon.count ();
+        }
+    }
+    allocate (model.count (), polygonCount, vertexCount);
+    if (m_arena == nullptr)
+    {
+        return;
+    }
+
+    LayerRange *layers (layerData ());
+    PolygonRange *polygons (polygonData ());
+    Point *points (pointData ());
+    qint64 polygonIndex (0);
+    qint64 vertexIndex (0);
+    for (int index = 0; index < model.count (); ++index)
+    {
+        const Layer &source (model.constAt (index));
+        LayerRange &layer (layers [index]);
+        layer.height = source.height ();
+        layer.thickness = source.thickness ();
+        layer.firstPolygon = polygonIndex;
+        layer.polygonCount = source.count ();
+        layer.firstVertex = vertexIndex;
+
+        for (const Polygon &polygon : source)
+        {
+            PolygonRange &range (polygons [polygonIndex++]);
+            range.firstVertex = vertexIndex;
+            range.vertexCount = quint32 (polygon.count ());
+            range.type = polygon.type ();
+            if (! polygon.isEmpty ())
+            {
+                std::memcpy (points + vertexIndex, polygon.constData (), sizeof (Point) * size_t (polygon.count ()));
+            }
+            vertexIndex += polygon.count ();
+        }
+        layer.vertexCount = vertexIndex - layer.firstVertex;
+    }
+}
+
+PackedModel::PackedModel (const PackedModel &other) :
+    m_name (other.m_name)
+{
+    allocate (other.m_layerCount, other.m_polygonCount, other.m_vertexCount);
+    if (m_arena != nullptr)
+    {
+        std::memcpy (m_arena, other.m_arena, size_t (byteCount ()));
+    }
+}
+
+PackedModel::PackedModel (PackedModel &&other) :
+    m_arena (other.m_arena),
+    m_layerCount (other.m_layerCount),
+    m_polygonCount (other.m_polygonCount),
+    m_vertexCount (other.m_vertexCount),
+    m_name (std::move (other.m_name))
+{
+    other.m_arena = nullptr;
+    other.m_layerCount = 0;
+    other.m_polygonCount = 0;
+    other.m_vertexCount = 0;
+}
+
+PackedModel::~PackedModel ()
+{
+    release ();
+}
+
+PackedModel &PackedModel::operator = (const PackedModel &other)
+{
+    if (this != &other)
+    {
+        PackedModel copy (other);
+        *this = std::move (copy);
+    }
+    return *this;
+}
+
+PackedModel &PackedModel::operator = (PackedModel &&other)
+{
+    if (this != &other)
+    {
+        release ();
+        std::swap (m_arena, other.m_arena);
+        std::swap (m_layerCount, other.m_layerCount);
+        std::swap (m_polygonCount, other.m_polygonCount);
+        std::swap (m_vertexCount, other.m_vertexCount);
+        m_name = std::move (other.m_name);
+    }
+    return *this;
+}
+
+/**
+ * @brief 读取 SLC 文件
+ *
+ * 先扫描一遍各层的多边形与顶点数, 一次分配全部存储, 再由 threadCount 个线程把各层直接解码到
+ * 各自的区间中. 层按高度排序, 结果与 Model::readSLC 相同.
+ * @param threadCount 线程数, 小于等于 0 时使用 QThread::idealThreadCount ()
+ */
+PackedModel PackedModel::readSLC (const QString &filename, int threadCount)
+{
+    SLCKIT_PROFILE_SCOPE ("PackedModel::readSLC");
+
+    PackedModel model;
+    do
+    {
+        SLCReader reader;
+        if (! reader.open (filename))
+        {
+            break;
+        }
+
+        const QVector<SLCReader::LayerRecord> records (reader.scan ());
+        qint64 polygonCount (0);
+        qint64 vertexCount (0);
+        for (const SLCReader::LayerRecord &record : records)
+        {
+            polygonCount += record.polygonCount;
+            vertexCount += qint64 (record.vertexCount);
+        }
+
+        PackedModel packed (records.count (), polygonCount, vertexCount);
+        if (packed.byteCount () == 0 && ! records.isEmpty ())
+        {
+            break;
+        }
+        LayerRange *layers (packed.layerData ());
+        polygonCount = 0;
+        vertexCount = 0;
+        for (int index = 0; index < records.count (); ++index)
+        {
+            layers [index].firstPolygon = polygonCount;
+            layers [index].polygonCount = records.at (index).polygonCount;
+            layers [index].firstVertex = vertexCount;
+            layers [index].vertexCount = qint64 (records.at (index).vertexCount);
+            polygonCount += layers [index].polygonCount;
+            vertexCount += layers [index].vertexCount;
+        }
+
+        QVector<char> decoded (records.count (), 0);
+        char *flags (decoded.data ());
+        parallelFor (records.count (), threadCount, [&] (int index)
+        {
+            qint64 offset (records.at (index).offset);
+            flags [index] = reader.readLayer (offset, packed, index) ? 1 : 0;
+        });
+        reader.close ();
+
+        if (decoded.contains (0))
+        {
+            break;
+        }
+
+        packed.setName (QFileInfo (filename).baseName ());
+        packed.sort ();
+        model = std::move (packed);
+    }
+    while (false);
+    return model;
+}
+
+/**
+ * @brief 读取 XLC 文件, v3.0 文件按层目录一次分配后并行解码, v2.0 文件经 Model::readXLC 转换
+ * @param threadCount 线程数, 小于等于 0 时使用 QThread::idealThreadCount ()
+ */
+PackedModel PackedModel::readXLC (const QString &filename, int threadCount)
+{
+    SLCKIT_PROFILE_SCOPE ("PackedModel::readXLC");
+
+    PackedModel model;
+    do
+    {
+        XLCReader reader;
+        if (! reader.open (filename))
+        {
+            model = PackedModel (Model::readXLC (filename));
+            break;
+        }
+
+        const QVector<XLCReader::LayerRecord> records (reader.records ());
+        qint64 polygonCount (0);
+        qint64 vertexCount (0);
+        for (const XLCReader::LayerRecord &record : records)
+        {
+            polygonCount += record.polygonCount;
+            vertexCount += record.vertexCount;
+        }
+
+        PackedModel packed (records.count (), polygonCount, vertexCount);
+        if (packed.byteCount () == 0 && ! records.isEmpty ())
+        {
+            break;
+        }
+        LayerRange *layers (packed.layerData ());
+        polygonCount = 0;
+        vertexCount = 0;
+        for (int index = 0; index < records.count (); ++index)
+        {
+            layers [index].firstPolygon = polygonCount;
+            layers [index].polygonCount = records.at (index).polygonCount;
+            layers [index].firstVertex = vertexCount;
+            layers [index].vertexCount = records.at (index).vertexCount;
+            polygonCount += layers [index].polygonCount;
+            vertexCount += layers [index].vertexCount;
+        }
+
+        QVector<char> decoded (records.count (), 0);
+        char *flags (decoded.data ());
+        parallelFor (records.count (), threadCount, [&] (int index)
+        {
+            flags [index] = reader.readLayer (index, packed) ? 1 : 0;
+        });
+
+        if (decoded.contains (0))
+        {
+            break;
+        }
+
+        packed.setName (reader.name ());
+        packed.sort ();
+        model = std::move (packed);
+    }
+    while (false);
+    return model;
+}
+
+const Model PackedModel::toModel () const
+{
+    Model model;
+    model.setName (m_name);
+    model.reserve (m_layerCount);
+    for (int index = 0; index < m_layerCount; ++index)
+    {
+        model.append (layer (index));
+    }
+    model.sort ();
+    return model;
+}
+
+const Layer PackedModel::layer (int index) const
+{
+    const LayerRange &range (constLayerData () [index]);
+    Layer layer;
+    layer.setHeight (range.height);
+    layer.setThickness (range.thickness);
+    layer.reserve (int (range.polygonCount));
+    for (qint64 i = 0; i < range.polygonCount; ++i)
+    {
+        layer.append (polygon (range.firstPolygon + i));
+    }
+    return layer;
+}
+
+const Polygon PackedModel::polygon (qint64 index) const
+{
+    const PolygonRange &range (constPolygonData () [index]);
+    Polygon polygon;
+    polygon.resize (int (range.vertexCount));
+    if (range.vertexCount > 0)
+    {
+        std::memcpy (polygon.data (), constPointData () + range.firstVertex, sizeof (Point) * range.vertexCount);
+    }
+    polygon.setType (range.type);
+    return polygon;
+}
+
+int PackedModel::count () const
+{
+    return m_layerCount;
+}
+
+bool PackedModel::isEmpty () const
+{
+    return (m_layerCount == 0);
+}
+
+qint64 PackedModel::polygonCount () const
+{
+    return m_polygonCount;
+}
+
+qint64 PackedModel::vertexCount () const
+{
+    return m_vertexCount;
+}
+
+/**
+ * @brief 内存块的字节数
+ */
+qint64 PackedModel::byteCount () const
+{
+    return arenaSize (m_layerCount, m_polygonCount, m_vertexCount);
+}
+
+PackedModel::LayerRange *PackedModel::layerData ()
+{
+    return reinterpret_cast<LayerRange *> (m_arena);
+}
+
+const PackedModel::LayerRange *PackedModel::constLayerData () const
+{
+    return reinterpret_cast<const LayerRange *> (m_arena);
+}
+
+PackedModel::PolygonRange *PackedModel::polygonData ()
+{
+    return reinterpret_cast<PolygonRange *> (m_arena + arenaSize (m_layerCount, 0, 0));
+}
+
+const PackedModel::PolygonRange *PackedModel::constPolygonData () const
+{
+    return reinterpret_cast<const PolygonRange *> (m_arena + arenaSize (m_layerCount, 0, 0));
+}
+
+Point *PackedModel::pointData ()
+{
+    return reinterpret_cast<Point *> (m_arena + arenaSize (m_layerCount, m_polygonCount, 0));
+}
+
+const Point *PackedModel::constPointData () const
+{
+    return reinterpret_cast<const Point *> (m_arena + arenaSize (m_layerCount, m_polygonCount, 0));
+}
+
+/**
+ * @brief 按高度稳定排序, 只移动层表中的记录, 多边形与顶点保持原位
+ */
+void PackedModel::sort ()
+{
+    SLCKIT_PROFILE_SCOPE ("PackedModel::sort");
+
+    LayerRange *layers (layerData ());
+    std::stable_sort (layers, layers + m_layerCount, [] (const LayerRange &a, const LayerRange &b)
+    {
+        return (a.height < b.height);
+    });
+}
+
+const Boundary PackedModel::boundary () const
+{
+    qreal lower [3] = {INFINITY, INFINITY, INFINITY};
+    qreal upper [3] = {-INFINITY, -INFINITY, -INFINITY};
+    const Point *points (constPointData ());
+    for (qint64 first = 0; first < m_vertexCount; first += KernelChunk)
+    {
+        boundaryKernel (points + first, int (std::min (KernelChunk, m_vertexCount - first)), lower, upper);
+    }
+    return kernelBoundary (lower, upper);
+}
+
+const Point PackedModel::center () const
+{
+    return boundary ().center ();
+}
+
+const Point PackedModel::dimension () const
+{
+    return boundary ().dimension ();
+}
+
+void PackedModel::translate (const Point &offset)
+{
+    Point *points (pointData ());
+    for (qint64 first = 0; first < m_vertexCount; first += KernelChunk)
+    {
+        translateKernel (points + first, int (std::min (KernelChunk, m_vertexCount - first)), offset);
+    }
+}
+
+const QString PackedModel::name () const
+{
+    return m_name;
+}
+
+void PackedModel::setName (const QString &name)
+{
+    m_name = name;
+}
+
+void PackedModel::allocate (int layerCount, qint64 polygonCount, qint64 vertexCount)
+{
+    release ();
+
+    const qint64 size (arenaSize (layerCount, polygonCount, vertexCount));
+    if (size <= 0)
+    {
+        return;
+    }
+
+    // the vertices are left uninitialized, every reader overwrites them anyway
+    m_arena = static_cast<char *> (std::malloc (size_t (size)));
+    if (m_arena == nullptr)
+    {
+        return;
+    }
+    std::memset (m_arena, 0, size_t (arenaSize (layerCount, polygonCount, 0)));
+    m_layerCount = layerCount;
+    m_polygonCount = polygonCount;
+    m_vertexCount = vertexCount;
+}
+
+void PackedModel::release ()
+{
+    std::free (m_arena);
+    m_arena = nullptr;
+    m_layerCount = 0;
+    m_polygonCount = 0;
+    m_vertexCount = 0;
+}
@@ -0,0 +1,72 @@
+﻿#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+
+template <typename Functor>
+class ParallelForTask : public QRunnable
+{
+public:
+    ParallelForTask (QAtomicInt &next, int count, const Functor &functor) :
+        m_next (next), m_count (count), m_functor (functor)
+    {}
+
+    void run () override
+    {
+        int index;
+        while ((index = m_next.fetchAndAddRelaxed (1)) < m_count)
+        {
+            m_functor (index);
+        }
+    }
+
+private:
+    QAtomicInt &m_next;
+    int m_count;
+    const Functor &m_functor;
+};
+
+/**
+ * @brief 以 threadCount 个线程 (含调用线程) 对 [0, count) 中每个下标执行 functor
+ *
+ * 各线程从共享计数器中动态领取下一个下标, 负载不均时空闲线程自动多做.
+ * functor 对不同下标的调用必须互不干扰; 函数返回时所有调用均已完成.
+ * @param threadCount 线程数, 小于等于 0 时使用 QThread::idealThreadCount ()
+ */
+template <typename Functor>
+void parallelFor (int count, int threadCount, const Functor &functor)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = QThread::idealThreadCount ();
+    }
+    threadCount = std::min (threadCount, count);
+
+    if (threadCount <= 1)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            functor (i);
+        }
+        return;
+    }
+
+    QAtomicInt next (0);
+    QThreadPool pool;
+    pool.setMaxThreadCount (threadCount - 1);
+    for (int i = 0; i < threadCount - 1; ++i)
+    {
+        pool.start (new ParallelForTask<Functor> (next, count, functor));
+    }
+
+    ParallelForTask<Functor> task (next, count, functor);
+    task.run ();
+
+    pool.waitForDone ();
+}
+
+#endif // PARALLEL_H
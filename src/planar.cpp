@@ -0,0 +1,751 @@
+﻿#include "planar.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <set>
+
+// resolveRings works on the arrangement of the input edges:
+//
+// 1. the edges are snap rounded: every end point and every crossing rounded
+//    to the integer grid is a hot pixel, and each edge is split at the centres
+//    of the hot pixels it passes, after which edges meet only at end points;
+// 2. coincident pieces are merged, their directions summed into a weight;
+// 3. a sweep in x keeps the pieces crossing the sweep line ordered by y, so
+//    the winding number below each piece is the one above its predecessor;
+// 4. pieces with inside on exactly one side are directed with the inside on
+//    their left and linked into rings, turning as far left as possible at
+//    shared vertices so that touching rings come out separate.
+
+namespace
+{
+
+/**
+ * @brief 主体 (subject) 与裁剪 (clip) 两组多边形各自的环绕数
+ */
+class Winding
+{
+public:
+    int subject;
+    int clip;
+
+    bool isZero () const
+    {
+        return (subject == 0 && clip == 0);
+    }
+
+    const Winding operator + (const Winding &other) const
+    {
+        return Winding {subject + other.subject, clip + other.clip};
+    }
+
+    const Winding operator - (const Winding &other) const
+    {
+        return Winding {subject - other.subject, clip - other.clip};
+    }
+
+    const Winding operator - () const
+    {
+        return Winding {-subject, -clip};
+    }
+};
+
+class Segment
+{
+public:
+    IntPoint a;
+    IntPoint b;
+    Winding weight;
+};
+
+class Piece
+{
+public:
+    IntPoint left;
+    IntPoint right;
+    Winding weight;
+    Winding below;
+    Winding above;
+};
+
+inline qint64 cross (const IntPoint &o, const IntPoint &a, const IntPoint &b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+/**
+ * @brief 覆盖所有线段外接矩形的均匀网格, 单元边长约为线段平均尺寸的两倍, 至多 1024 x 1024 个单元
+ */
+class Grid
+{
+public:
+    Grid (const QVector<Segment> &segments)
+    {
+        qint64 maxX (std::numeric_limits<qint64>::min ());
+        qint64 maxY (maxX);
+        qreal size (0.0);
+        for (const Segment &s : segments)
+        {
+            m_minX = std::min (m_minX, std::min (s.a.x, s.b.x));
+            m_minY = std::min (m_minY, std::min (s.a.y, s.b.y));
+            maxX = std::max (maxX, std::max (s.a.x, s.b.x));
+            maxY = std::max (maxY, std::max (s.a.y, s.b.y));
+            size += qreal (std::max (std::abs (s.b.x - s.a.x), std::abs (s.b.y - s.a.y)));
+        }
+
+        const qreal spanX (qreal (maxX - m_minX) + 1.0);
+        const qreal spanY (qreal (maxY - m_minY) + 1.0);
+        m_cell = std::max (std::max (2.0 * size / std::max (segments.count (), 1), 1.0),
+                           std::max (spanX, spanY) / 1024.0);
+        m_columns = int (spanX / m_cell) + 1;
+        m_rows = int (spanY / m_cell) + 1;
+    }
+
+    int columns () const { return m_columns; }
+    int rows () const { return m_rows; }
+    int cells () const { return m_columns * m_rows; }
+
+    // clamped, so that points slightly outside the segments still map to a cell
+    int column (qint64 x) const { return std::max (0, std::min (m_columns - 1, int (qreal (x - m_minX) / m_cell))); }
+    int row (qint64 y) const { return std::max (0, std::min (m_rows - 1, int (qreal (y - m_minY) / m_cell))); }
+
+private:
+    qint64 m_minX = std::numeric_limits<qint64>::max ();
+    qint64 m_minY = std::numeric_limits<qint64>::max ();
+    qreal m_cell = 1.0;
+    int m_columns = 1;
+    int m_rows = 1;
+};
+
+/**
+ * @brief 按单元分桶的压缩存储, 单元 k 的成员为 members [start [k], start [k + 1])
+ */
+class Buckets
+{
+public:
+    QVector<int> start;
+    QVector<int> members;
+
+    // visit (add, count) calls add (cell, member) for every membership, it runs twice: to count, then to fill
+    template <typename Visit>
+    void build (int cells, int count, const Visit &visit)
+    {
+        start.fill (0, cells + 1);
+        visit ([this] (int cell, int) { ++start [cell + 1]; }, count);
+        for (int k = 0; k < cells; ++k)
+        {
+            start [k + 1] += start.at (k);
+        }
+        members.resize (start.last ());
+        QVector<int> filled (start);
+        visit ([this, &filled] (int cell, int member) { members [filled [cell]++] = member; }, count);
+    }
+};
+
+/**
+ * @brief 线段 a, b 是否经过以 p 为中心, 边长为 1 的像素 (含边界)
+ */
+inline bool passes (const IntPoint &a, const IntPoint &b, const IntPoint &p)
+{
+    if (p.x < std::min (a.x, b.x) || p.x > std::max (a.x, b.x) ||
+        p.y < std::min (a.y, b.y) || p.y > std::max (a.y, b.y))
+    {
+        return false;
+    }
+    // the line misses the pixel when all four corners lie strictly on one side of it
+    const qint64 c (std::abs (cross (a, b, p)));
+    return (c <= (std::abs (b.x - a.x) + std::abs (b.y - a.y)) / 2);
+}
+
+/**
+ * @brief 以 snap rounding 切分线段, 使线段两两之间只在端点处相接或完全重合
+ *
+ * 所有端点与取整后的交点构成热像素, 每条线段在其经过的每个热像素中心处切分.
+ * 这样切分后的线段不再相交, 取整只需一遍, 不会因为取整产生新的交点.
+ */
+void splitSegments (QVector<Segment> &segments)
+{
+    if (segments.isEmpty ())
+    {
+        return;
+    }
+
+    const Grid grid (segments);
+    const auto coverSegments = [&segments, &grid] (const std::function<void (int, int)> &add, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const Segment &s (segments.at (i));
+            const int r1 (grid.row (std::max (s.a.y, s.b.y)));
+            const int c1 (grid.column (std::max (s.a.x, s.b.x)));
+            for (int r = grid.row (std::min (s.a.y, s.b.y)); r <= r1; ++r)
+                for (int c = grid.column (std::min (s.a.x, s.b.x)); c <= c1; ++c)
+                    add (r * grid.columns () + c, i);
+        }
+    };
+    Buckets cells;
+    cells.build (grid.cells (), segments.count (), coverSegments);
+
+    // hot pixels: the end points and the rounded proper crossings; the segments form
+    // closed rings, so every end point is the start of some segment
+    QVector<IntPoint> hot;
+    hot.reserve (segments.count () + segments.count () / 8);
+    for (const Segment &s : segments)
+    {
+        hot.append (s.a);
+    }
+
+    // a pair whose extents overlap shares all cells of the overlap, it is tested in the lowest one
+    for (int r = 0; r < grid.rows (); ++r)
+    {
+        for (int c = 0; c < grid.columns (); ++c)
+        {
+            const int k (r * grid.columns () + c);
+            for (int m = cells.start.at (k); m < cells.start.at (k + 1); ++m)
+            {
+                const Segment &s (segments.at (cells.members.at (m)));
+                for (int n = m + 1; n < cells.start.at (k + 1); ++n)
+                {
+                    const Segment &t (segments.at (cells.members.at (n)));
+                    if (std::max (t.a.x, t.b.x) < std::min (s.a.x, s.b.x) || std::min (t.a.x, t.b.x) > std::max (s.a.x, s.b.x) ||
+                        std::max (t.a.y, t.b.y) < std::min (s.a.y, s.b.y) || std::min (t.a.y, t.b.y) > std::max (s.a.y, s.b.y) ||
+                        grid.column (std::max (std::min (s.a.x, s.b.x), std::min (t.a.x, t.b.x))) != c ||
+                        grid.row (std::max (std::min (s.a.y, s.b.y), std::min (t.a.y, t.b.y))) != r)
+                    {
+                        continue;
+                    }
+
+                    const qint64 o1 (cross (s.a, s.b, t.a));
+                    const qint64 o2 (cross (s.a, s.b, t.b));
+                    const qint64 o3 (cross (t.a, t.b, s.a));
+                    const qint64 o4 (cross (t.a, t.b, s.b));
+                    if (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0)))
+                    {
+                        const long double t ((long double) (o3) / ((long double) (o3) - (long double) (o4)));
+                        hot.append (IntPoint {qint64 (std::llround (s.a.x + t * (s.b.x - s.a.x))),
+                                              qint64 (std::llround (s.a.y + t * (s.b.y - s.a.y)))});
+                    }
+                }
+            }
+        }
+    }
+
+    Buckets pixels;
+    pixels.build (grid.cells (), hot.count (), [&hot, &grid] (const std::function<void (int, int)> &add, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            add (grid.row (hot.at (i).y) * grid.columns () + grid.column (hot.at (i).x), i);
+        }
+    });
+
+    QVector<Segment> pieces;
+    pieces.reserve (segments.count () * 2);
+    QVector<IntPoint> points;
+    for (const Segment &s : segments)
+    {
+        points.clear ();
+        const int r1 (grid.row (std::max (s.a.y, s.b.y) + 1));
+        const int c1 (grid.column (std::max (s.a.x, s.b.x) + 1));
+        for (int r = grid.row (std::min (s.a.y, s.b.y) - 1); r <= r1; ++r)
+        {
+            for (int c = grid.column (std::min (s.a.x, s.b.x) - 1); c <= c1; ++c)
+            {
+                const int k (r * grid.columns () + c);
+                for (int m = pixels.start.at (k); m < pixels.start.at (k + 1); ++m)
+                {
+                    const IntPoint &p (hot.at (pixels.members.at (m)));
+                    // duplicates are harmless, splitting skips empty pieces
+                    if (p != s.a && p != s.b && passes (s.a, s.b, p))
+                    {
+                        points.append (p);
+                    }
+                }
+            }
+        }
+
+        if (points.isEmpty ())
+        {
+            pieces.append (s);
+            continue;
+        }
+
+        const qint64 dx (s.b.x - s.a.x);
+        const qint64 dy (s.b.y - s.a.y);
+        std::sort (points.begin (), points.end (), [&s, dx, dy] (const IntPoint &p, const IntPoint &q)
+        {
+            return ((p.x - s.a.x) * dx + (p.y - s.a.y) * dy < (q.x - s.a.x) * dx + (q.y - s.a.y) * dy);
+        });
+
+        IntPoint from (s.a);
+        for (const IntPoint &point : points)
+        {
+            if (point != from)
+            {
+                pieces.append (Segment {from, point, s.weight});
+                from = point;
+            }
+        }
+        if (s.b != from)
+        {
+            pieces.append (Segment {from, s.b, s.weight});
+        }
+    }
+    segments.swap (pieces);
+}
+
+/**
+ * @brief 合并重合的线段, 统一为从左 (x, y 较小) 到右的方向
+ */
+const QVector<Piece> mergeSegments (const QVector<Segment> &segments)
+{
+    QVector<Piece> pieces;
+    pieces.reserve (segments.count ());
+    for (const Segment &s : segments)
+    {
+        if (s.a < s.b)
+            pieces.append (Piece {s.a, s.b, s.weight, Winding {0, 0}, Winding {0, 0}});
+        else
+            pieces.append (Piece {s.b, s.a, -s.weight, Winding {0, 0}, Winding {0, 0}});
+    }
+    std::sort (pieces.begin (), pieces.end (), [] (const Piece &p, const Piece &q)
+    {
+        return (p.left < q.left || (p.left == q.left && p.right < q.right));
+    });
+
+    int merged (0);
+    for (int i = 0; i < pieces.count (); ++i)
+    {
+        if (merged > 0 && pieces.at (merged - 1).left == pieces.at (i).left && pieces.at (merged - 1).right == pieces.at (i).right)
+        {
+            pieces [merged - 1].weight = pieces.at (merged - 1).weight + pieces.at (i).weight;
+        }
+        else
+        {
+            pieces [merged++] = pieces.at (i);
+        }
+    }
+    pieces.resize (merged);
+
+    // opposite edges cancel out and separate nothing
+    pieces.erase (std::remove_if (pieces.begin (), pieces.end (), [] (const Piece &p) { return p.weight.isZero (); }),
+                  pieces.end ());
+    return pieces;
+}
+
+class SweepOrder
+{
+public:
+    SweepOrder (const QVector<Piece> &pieces, const qint64 &x, const qreal &probe) :
+        m_pieces (pieces), m_x (x), m_probe (probe)
+    {}
+
+    // index -1 stands for the point (x, probe)
+    bool operator () (int i, int j) const
+    {
+        const qreal yi (y (i));
+        const qreal yj (y (j));
+        if (yi != yj)
+        {
+            return (yi < yj);
+        }
+        if (i < 0 || j < 0)
+        {
+            // a probe on a piece counts as above it
+            return (j < 0);
+        }
+
+        // pieces meeting on the sweep line share their left end, the lower slope is below
+        const Piece &p (m_pieces.at (i));
+        const Piece &q (m_pieces.at (j));
+        const qint64 lhs ((p.right.y - p.left.y) * (q.right.x - q.left.x));
+        const qint64 rhs ((q.right.y - q.left.y) * (p.right.x - p.left.x));
+        return (lhs != rhs) ? (lhs < rhs) : (i < j);
+    }
+
+private:
+    qreal y (int index) const
+    {
+        if (index < 0)
+        {
+            return m_probe;
+        }
+        const Piece &p (m_pieces.at (index));
+        if (m_x == p.left.x)
+        {
+            return qreal (p.left.y);
+        }
+        if (m_x == p.right.x)
+        {
+            return qreal (p.right.y);
+        }
+        return p.left.y + qreal (p.right.y - p.left.y) * qreal (m_x - p.left.x) / qreal (p.right.x - p.left.x);
+    }
+
+    const QVector<Piece> &m_pieces;
+    const qint64 &m_x;
+    const qreal &m_probe;
+};
+
+/**
+ * @brief 求每段两侧的环绕数
+ *
+ * 非竖直段记录其下方 (below) 与上方 (above) 的环绕数, 竖直段记录其右侧与左侧的环绕数,
+ * 两种情况下都有 above = below + weight, 主体与裁剪多边形的环绕数分别计算.
+ */
+void windPieces (QVector<Piece> &pieces)
+{
+    QVector<int> inserts, removes, verticals;
+    for (int i = 0; i < pieces.count (); ++i)
+    {
+        if (pieces.at (i).left.x == pieces.at (i).right.x)
+        {
+            verticals.append (i);
+        }
+        else
+        {
+            inserts.append (i);
+            removes.append (i);
+        }
+    }
+
+    // pieces come sorted by their left end, so inserts and verticals are in sweep order already;
+    // pieces sharing a left end are inserted bottom up, so the ones already in place stay valid
+    const auto lowerSlope = [&pieces] (int a, int b)
+    {
+        const Piece &p (pieces.at (a));
+        const Piece &q (pieces.at (b));
+        return ((p.right.y - p.left.y) * (q.right.x - q.left.x) < (q.right.y - q.left.y) * (p.right.x - p.left.x));
+    };
+    for (int i = 0; i < inserts.count ();)
+    {
+        int j (i + 1);
+        while (j < inserts.count () && pieces.at (inserts.at (j)).left == pieces.at (inserts.at (i)).left)
+        {
+            ++j;
+        }
+        if (j - i > 1)
+        {
+            std::sort (inserts.begin () + i, inserts.begin () + j, lowerSlope);
+        }
+        i = j;
+    }
+    std::sort (removes.begin (), removes.end (), [&pieces] (int a, int b)
+    {
+        return (pieces.at (a).right.x < pieces.at (b).right.x);
+    });
+
+    qint64 x (0);
+    qreal probe (0.0);
+    typedef std::set<int, SweepOrder> Status;
+    Status status ((SweepOrder (pieces, x, probe)));
+    std::vector<Status::iterator> positions (pieces.count ());
+
+    int insert (0), remove (0), vertical (0);
+    while (insert < inserts.count () || vertical < verticals.count ())
+    {
+        x = std::numeric_limits<qint64>::max ();
+        if (insert < inserts.count ())
+            x = std::min (x, pieces.at (inserts.at (insert)).left.x);
+        if (remove < removes.count ())
+            x = std::min (x, pieces.at (removes.at (remove)).right.x);
+        if (vertical < verticals.count ())
+            x = std::min (x, pieces.at (verticals.at (vertical)).left.x);
+
+        // vertical pieces see the pieces reaching x from the left
+        for (; vertical < verticals.count () && pieces.at (verticals.at (vertical)).left.x == x; ++vertical)
+        {
+            Piece &piece (pieces [verticals.at (vertical)]);
+            probe = 0.5 * qreal (piece.left.y + piece.right.y);
+            const Status::iterator position (status.insert (-1).first);
+            piece.above = (position == status.begin ()) ? Winding {0, 0} : pieces.at (*std::prev (position)).above;
+            piece.below = piece.above - piece.weight;
+            status.erase (position);
+        }
+
+        for (; remove < removes.count () && pieces.at (removes.at (remove)).right.x == x; ++remove)
+        {
+            status.erase (positions [removes.at (remove)]);
+        }
+
+        for (; insert < inserts.count () && pieces.at (inserts.at (insert)).left.x == x; ++insert)
+        {
+            const int index (inserts.at (insert));
+            const Status::iterator position (status.insert (index).first);
+            positions [index] = position;
+            Piece &piece (pieces [index]);
+            piece.below = (position == status.begin ()) ? Winding {0, 0} : pieces.at (*std::prev (position)).above;
+            piece.above = piece.below + piece.weight;
+        }
+    }
+}
+
+/**
+ * @brief 将有向边连成环
+ *
+ * 在多条边相接的顶点处, 选择从来边的反方向顺时针转过的第一条出边, 即沿区域左转最多的一条.
+ */
+const IntRings linkEdges (const QVector<Segment> &edges)
+{
+    QVector<int> order (edges.count ());
+    for (int i = 0; i < order.count (); ++i)
+    {
+        order [i] = i;
+    }
+    std::sort (order.begin (), order.end (), [&edges] (int a, int b)
+    {
+        return (edges.at (a).a < edges.at (b).a);
+    });
+
+    QVector<bool> used (edges.count (), false);
+    IntRings rings;
+    IntRing ring;
+
+    for (int start = 0; start < edges.count (); ++start)
+    {
+        if (used.at (start))
+        {
+            continue;
+        }
+
+        ring.clear ();
+        int current (start);
+        bool closed (false);
+        for (int step = 0; step <= edges.count (); ++step)
+        {
+            used [current] = true;
+            const Segment &edge (edges.at (current));
+            ring.append (edge.a);
+
+            const IntPoint &vertex (edge.b);
+            const int lower (std::lower_bound (order.cbegin (), order.cend (), vertex, [&edges] (int e, const IntPoint &p)
+            {
+                return (edges.at (e).a < p);
+            }) - order.cbegin ());
+            int upper (lower);
+            while (upper < order.count () && edges.at (order.at (upper)).a == vertex)
+            {
+                ++upper;
+            }
+
+            int next (-1);
+            if (upper - lower == 1)
+            {
+                const int candidate (order.at (lower));
+                if (! used.at (candidate) || candidate == start)
+                {
+                    next = candidate;
+                }
+            }
+            else
+            {
+                const qreal back (std::atan2 (qreal (edge.a.y - vertex.y), qreal (edge.a.x - vertex.x)));
+                qreal best (0.0);
+                for (int k = lower; k < upper; ++k)
+                {
+                    const int candidate (order.at (k));
+                    if (used.at (candidate) && candidate != start)
+                    {
+                        continue;
+                    }
+                    const Segment &out (edges.at (candidate));
+                    qreal turn (back - std::atan2 (qreal (out.b.y - vertex.y), qreal (out.b.x - vertex.x)));
+                    while (turn <= 0.0)
+                        turn += 2.0 * PI;
+                    while (turn > 2.0 * PI)
+                        turn -= 2.0 * PI;
+                    if (next < 0 || turn < best)
+                    {
+                        next = candidate;
+                        best = turn;
+                    }
+                }
+            }
+
+            if (next < 0)
+            {
+                break;
+            }
+            if (next == start)
+            {
+                closed = true;
+                break;
+            }
+            current = next;
+        }
+
+        if (! closed)
+        {
+            continue;
+        }
+
+        // drop collinear vertices
+        bool changed (true);
+        while (changed && ring.count () >= 3)
+        {
+            changed = false;
+            IntRing kept;
+            kept.reserve (ring.count ());
+            for (int i = 0; i < ring.count (); ++i)
+            {
+                const IntPoint &previous (kept.isEmpty () ? ring.last () : kept.last ());
+                if (cross (previous, ring.at (i), ring.at ((i + 1) % ring.count ())) == 0)
+                {
+                    changed = true;
+                    continue;
+                }
+                kept.append (ring.at (i));
+            }
+            ring.swap (kept);
+        }
+        if (ring.count () >= 3)
+        {
+            rings.append (ring);
+        }
+    }
+    return rings;
+}
+
+void appendRings (const IntRings &rings, const Winding &weight, QVector<Segment> &segments)
+{
+    for (const IntRing &ring : rings)
+    {
+        for (int i = 0; i < ring.count (); ++i)
+        {
+            const IntPoint &a (ring.at (i));
+            const IntPoint &b (ring.at ((i + 1) % ring.count ()));
+            if (a != b)
+            {
+                segments.append (Segment {a, b, weight});
+            }
+        }
+    }
+}
+
+/**
+ * @brief 求 segments 所围区域中满足 inside 的部分的边界
+ */
+template <typename Inside>
+const IntRings resolveSegments (QVector<Segment> &segments, const Inside &inside)
+{
+    splitSegments (segments);
+    QVector<Piece> pieces (mergeSegments (segments));
+    windPieces (pieces);
+
+    QVector<Segment> edges;
+    for (const Piece &piece : pieces)
+    {
+        const bool below (inside (piece.below));
+        const bool above (inside (piece.above));
+        if (above && ! below)
+        {
+            edges.append (Segment {piece.left, piece.right, Winding {1, 0}});
+        }
+        else if (below && ! above)
+        {
+            edges.append (Segment {piece.right, piece.left, Winding {1, 0}});
+        }
+    }
+    return linkEdges (edges);
+}
+
+bool isInside (int winding, FillRule rule)
+{
+    switch (rule)
+    {
+    case EvenOddFill:
+        return (winding % 2 != 0);
+    case NonZeroFill:
+        return (winding != 0);
+    case PositiveFill:
+        return (winding > 0);
+    case NegativeFill:
+        return (winding < 0);
+    }
+    return false;
+}
+
+}
+
+IntRings resolveRings (const IntRings &rings, FillRule rule)
+{
+    QVector<Segment> segments;
+    appendRings (rings, Winding {1, 0}, segments);
+    return resolveSegments (segments, [rule] (const Winding &winding)
+    {
+        return isInside (winding.subject, rule);
+    });
+}
+
+IntRings clipRings (const IntRings &subject, const IntRings &clip, ClipOperation operation)
+{
+    QVector<Segment> segments;
+    appendRings (subject, Winding {1, 0}, segments);
+    appendRings (clip, Winding {0, 1}, segments);
+    return resolveSegments (segments, [operation] (const Winding &winding)
+    {
+        const bool inSubject (isInside (winding.subject, EvenOddFill));
+        const bool inClip (isInside (winding.clip, EvenOddFill));
+        switch (operation)
+        {
+        case UnionClip:
+            return (inSubject || inClip);
+        case IntersectionClip:
+            return (inSubject && inClip);
+        case DifferenceClip:
+            return (inSubject && ! inClip);
+        case XorClip:
+            return (inSubject != inClip);
+        }
+        return false;
+    });
+}
+
+IntRings uniteRegions (const QVector<IntRings> &regions)
+{
+    QVector<Segment> segments;
+    for (const IntRings &region : regions)
+    {
+        appendRings (resolveRings (region, EvenOddFill), Winding {1, 0}, segments);
+    }
+    return resolveSegments (segments, [] (const Winding &winding)
+    {
+        return (winding.subject > 0);
+    });
+}
+
+const IntRing toIntRing (const Polygon &polygon)
+{
+    IntRing ring;
+    ring.reserve (polygon.count ());
+    for (const Point &point : polygon)
+    {
+        const IntPoint p {qint64 (std::llround (point.x () * planarScale)), qint64 (std::llround (point.y () * planarScale))};
+        if (ring.isEmpty () || ring.last () != p)
+        {
+            ring.append (p);
+        }
+    }
+    while (ring.count () > 1 && ring.first () == ring.last ())
+    {
+        ring.removeLast ();
+    }
+    return ring;
+}
+
+const Polygon toPolygon (const IntRing &ring, qreal z, Polygon::PolygonType type)
+{
+    Polygon polygon;
+    polygon.setType (type);
+    polygon.reserve (ring.count () + 1);
+    for (const IntPoint &p : ring)
+    {
+        polygon.append (Point (p.x / planarScale, p.y / planarScale, z));
+    }
+    if (! ring.isEmpty ())
+    {
+        polygon.append (polygon.first ());
+    }
+    return polygon;
+}
@@ -0,0 +1,121 @@
+﻿#ifndef PLANAR_H
+#define PLANAR_H
+
+#include "polygon.h"
+
+/**
+ * @brief 整数坐标点, 坐标为原坐标乘以 planarScale 后取整
+ *
+ * 方向判断用 64 位整数精确计算, 要求坐标绝对值小于 2^30.
+ */
+class IntPoint
+{
+public:
+    qint64 x;
+    qint64 y;
+
+    bool operator == (const IntPoint &other) const
+    {
+        return (x == other.x && y == other.y);
+    }
+
+    bool operator != (const IntPoint &other) const
+    {
+        return ! operator == (other);
+    }
+
+    bool operator < (const IntPoint &other) const
+    {
+        return (x < other.x || (x == other.x && y < other.y));
+    }
+};
+
+typedef QVector<IntPoint> IntRing;
+typedef QVector<IntRing> IntRings;
+
+/**
+ * @brief 坐标到整数坐标的缩放系数, 即整数坐标的分辨率为 PREC
+ */
+static const qreal planarScale = PREC_RANGE;
+
+/**
+ * @brief RoundJoin 圆弧的最大弦高, 单位为整数坐标, 即 0.001
+ */
+static const qreal planarArcTolerance = 1e-3 * planarScale;
+
+/**
+ * @brief 环绕数判断内外的规则
+ */
+enum FillRule
+{
+    EvenOddFill,
+    NonZeroFill,
+    PositiveFill,
+    NegativeFill,
+};
+
+/**
+ * @brief 求 rings 按 rule 围成的区域, 自交与重叠在此消解
+ *
+ * 输入环无需闭合, 也无需特定方向. 输出为互不相交的简单环, 区域始终在环的左侧,
+ * 即外环逆时针, 孔洞顺时针, 同样不重复首点.
+ */
+IntRings resolveRings (const IntRings &rings, FillRule rule);
+
+/**
+ * @brief 布尔运算的类型
+ */
+enum ClipOperation
+{
+    UnionClip,
+    IntersectionClip,
+    DifferenceClip,
+    XorClip,
+};
+
+/**
+ * @brief 对 subject 与 clip 各自按奇偶规则围成的区域做布尔运算
+ *
+ * 两组环一同切分与扫描, 每段分别记录两组的环绕数, 因此一遍即可得到结果.
+ * 输出与 resolveRings 相同.
+ */
+IntRings clipRings (const IntRings &subject, const IntRings &clip, ClipOperation operation);
+
+/**
+ * @brief 求多个区域的并集, 每个区域各自按奇偶规则围成
+ *
+ * 各区域先分别消解为外环逆时针, 孔洞顺时针的环, 再以正环绕数规则一次合并,
+ * 代价与区域总边数相当, 不随区域个数成倍增长.
+ */
+IntRings uniteRegions (const QVector<IntRings> &regions);
+
+/**
+ * @brief 求 rings 按奇偶规则围成的区域向外偏置 delta 后的区域, delta 为负时向内收缩
+ * @param delta 偏置距离, 单位为整数坐标
+ * @param miterLimit MiterJoin 时尖角长度与 |delta| 之比的上限, 超过时改为 BevelJoin
+ * @param arcTolerance RoundJoin 时圆弧的最大弦高, 单位为整数坐标
+ */
+IntRings offsetRings (const IntRings &rings,
+                      qreal delta,
+                      Polygon::JoinType join,
+                      qreal miterLimit,
+                      qreal arcTolerance);
+
+/**
+ * @brief 与 offsetRings 相同, 但 region 已是 resolveRings 的结果, 省去一次消解
+ *
+ * 结果同样满足这一条件, 因此可以在上一次偏置的结果上继续偏置.
+ */
+IntRings offsetRegion (const IntRings &region,
+                       qreal delta,
+                       Polygon::JoinType join,
+                       qreal miterLimit,
+                       qreal arcTolerance);
+
+/**
+ * @brief Polygon 与整数环之间的转换, 转换为 Polygon 时补上闭合点
+ */
+const IntRing toIntRing (const Polygon &polygon);
+const Polygon toPolygon (const IntRing &ring, qreal z, Polygon::PolygonType type);
+
+#endif // PLANAR_H
@@ -1,5 +1,10 @@
 ﻿#include "polygon.h"
+#include "kernels.h"
+#include "planar.h"
+#include "profiling.h"
 #include <algorithm>
+#include <functional>
+#include <queue>
 
 void Polygon::setType (Polygon::PolygonType type)
 {
@@ -11,60 +16,278 @@ Polygon::PolygonType Polygon::type () const
     return m_type;
 }
 
+/**
+ * @brief 删除重复的顶点及同向共线的中间顶点
+ *
+ * 从后向前单遍压缩, 每个顶点只与前一个顶点及其后最近的保留顶点比较.
+ * 共线判断不开方也不做除法: 两段方向的夹角正弦小于 PREC 且方向相同即视为共线.
+ * 这与逐分量比较单位方向的旧实现不完全相同, 接近阈值的顶点可能保留或删除得不一样.
+ */
 void Polygon::simplify()
 {
-    for (int i = count () - 2; i > 0; --i)
+    const int N (count ());
+    if (N < 3)
     {
-        if (count () < 3)
-            break;
+        return;
+    }
 
-        const Point prevDelta ( (*this)[i] - (*this)[i-1]);
-        const Point nextDelta ( (*this)[i+1] - (*this)[i]);
+    Point *points (data ());
+
+    // kept vertices are gathered at the back, points [kept] being the nearest one after i
+    int kept (N - 1);
+    for (int i = N - 2; i > 0; --i)
+    {
+        const Point &prev (points [i - 1]);
+        const Point &current (points [i]);
+        const Point nextDelta (points [kept] - current);
 
         if (nextDelta.isZero ())
         {
-            removeAt (i);
             continue;
         }
 
-        qreal prevDeltaLength (prevDelta.length ());
-        qreal prevDeltaSlopeX (prevDelta.x () / prevDeltaLength);
-        qreal prevDeltaSlopeY (prevDelta.y () / prevDeltaLength);
-        qreal prevDeltaSlopeZ (prevDelta.z () / prevDeltaLength);
+        const Point prevDelta (current - prev);
+
+        const qreal prevLength2 (prevDelta.x () * prevDelta.x () + prevDelta.y () * prevDelta.y () + prevDelta.z () * prevDelta.z ());
+        const qreal nextLength2 (nextDelta.x () * nextDelta.x () + nextDelta.y () * nextDelta.y () + nextDelta.z () * nextDelta.z ());
+        const qreal dot (prevDelta.x () * nextDelta.x () + prevDelta.y () * nextDelta.y () + prevDelta.z () * nextDelta.z ());
+
+        const qreal crossX (prevDelta.y () * nextDelta.z () - prevDelta.z () * nextDelta.y ());
+        const qreal crossY (prevDelta.z () * nextDelta.x () - prevDelta.x () * nextDelta.z ());
+        const qreal crossZ (prevDelta.x () * nextDelta.y () - prevDelta.y () * nextDelta.x ());
+        const qreal cross2 (crossX * crossX + crossY * crossY + crossZ * crossZ);
+
+        bool collinear (prevLength2 > 0.0 &&
+                        dot > 0.0 &&
+                        cross2 < PREC * PREC * prevLength2 * nextLength2);
+        if (! collinear)
+        {
+            points [--kept] = current;
+        }
+    }
+    points [--kept] = points [0];
+
+    std::copy (points + kept, points + N, points);
+    resize (N - kept);
+}
+
+static inline qreal segmentDistance2 (const Point &point, const Point &a, const Point &b)
+{
+    const qreal dx (b.x () - a.x ());
+    const qreal dy (b.y () - a.y ());
+    const qreal length2 (dx * dx + dy * dy);
+
+    qreal px (point.x () - a.x ());
+    qreal py (point.y () - a.y ());
+    if (length2 > 0.0)
+    {
+        qreal t ((px * dx + py * dy) / length2);
+        t = std::max (qreal (0.0), std::min (qreal (1.0), t));
+        px -= t * dx;
+        py -= t * dy;
+    }
+    return px * px + py * py;
+}
+
+static inline qreal triangleArea (const Point &a, const Point &b, const Point &c)
+{
+    return std::abs ((b.x () - a.x ()) * (c.y () - a.y ()) - (c.x () - a.x ()) * (b.y () - a.y ())) / 2.0;
+}
+
+/**
+ * @brief Douglas-Peucker 简化, 保留偏离保留折线超过 tolerance 的顶点
+ * @param keep 输出每个顶点是否保留
+ */
+static void douglasPeucker (const Point *points, int N, qreal tolerance, QVector<bool> &keep)
+{
+    keep.fill (false, N);
+    keep [0] = true;
+    keep [N - 1] = true;
+
+    const qreal tolerance2 (tolerance * tolerance);
+
+    // explicit stack instead of recursion, dense contours would overflow the call stack
+    QVector<QPair<int, int> > ranges;
+    ranges.append (qMakePair (0, N - 1));
+    while (! ranges.isEmpty ())
+    {
+        const QPair<int, int> range (ranges.takeLast ());
+        const Point &a (points [range.first]);
+        const Point &b (points [range.second]);
+
+        int farthest (-1);
+        qreal farthestDistance2 (tolerance2);
+        for (int i = range.first + 1; i < range.second; ++i)
+        {
+            qreal distance2 (segmentDistance2 (points [i], a, b));
+            if (distance2 > farthestDistance2)
+            {
+                farthest = i;
+                farthestDistance2 = distance2;
+            }
+        }
+
+        if (farthest > 0)
+        {
+            keep [farthest] = true;
+            ranges.append (qMakePair (range.first, farthest));
+            ranges.append (qMakePair (farthest, range.second));
+        }
+    }
+}
+
+/**
+ * @brief Visvalingam-Whyatt 简化, 反复删除与相邻顶点构成三角形面积最小的顶点,
+ * 直至最小面积不小于 tolerance 或只剩 minimum 个顶点
+ * @param keep 输出每个顶点是否保留
+ */
+static void visvalingam (const Point *points, int N, qreal tolerance, int minimum, QVector<bool> &keep)
+{
+    keep.fill (true, N);
+
+    QVector<int> prev (N), next (N);
+    QVector<qreal> area (N, INFINITY);
+    for (int i = 0; i < N; ++i)
+    {
+        prev [i] = i - 1;
+        next [i] = i + 1;
+    }
+
+    // min-heap of (area, vertex), stale entries are skipped when popped
+    typedef QPair<qreal, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > heap;
+    for (int i = 1; i < N - 1; ++i)
+    {
+        area [i] = triangleArea (points [i - 1], points [i], points [i + 1]);
+        heap.push (qMakePair (area [i], i));
+    }
+
+    int remaining (N);
+    while (! heap.empty () && remaining > minimum)
+    {
+        const Entry entry (heap.top ());
+        heap.pop ();
+
+        const int i (entry.second);
+        if (! keep [i] || entry.first != area [i])
+        {
+            continue;
+        }
+        if (entry.first >= tolerance)
+        {
+            break;
+        }
+
+        keep [i] = false;
+        --remaining;
 
-        qreal nextDeltaLength (nextDelta.length ());
-        qreal nextDeltaSlopeX (nextDelta.x () / nextDeltaLength);
-        qreal nextDeltaSlopeY (nextDelta.y () / nextDeltaLength);
-        qreal nextDeltaSlopeZ (nextDelta.z () / nextDeltaLength);
+        const int p (prev [i]);
+        const int n (next [i]);
+        next [p] = n;
+        prev [n] = p;
 
-        if (fuzzyIsEqual (prevDeltaSlopeX, nextDeltaSlopeX) &&
-            fuzzyIsEqual (prevDeltaSlopeY, nextDeltaSlopeY) &&
-            fuzzyIsEqual (prevDeltaSlopeZ, nextDeltaSlopeZ))
+        // a neighbour never gets a smaller area than the vertex just removed,
+        // so that vertices are removed in a consistent order
+        if (p > 0)
         {
-            removeAt (i);
+            area [p] = std::max (entry.first, triangleArea (points [prev [p]], points [p], points [n]));
+            heap.push (qMakePair (area [p], p));
         }
+        if (n < N - 1)
+        {
+            area [n] = std::max (entry.first, triangleArea (points [p], points [n], points [next [n]]));
+            heap.push (qMakePair (area [n], n));
+        }
+    }
+}
+
+/**
+ * @brief 按容差简化多边形, 首末顶点总是保留. Visvalingam 方式下闭合的多边形至少保留 4 个顶点
+ * @param tolerance DouglasPeucker 为允许偏离的距离, Visvalingam 为可删除的最大三角形面积
+ */
+void Polygon::simplify (qreal tolerance, SimplifyMethod method)
+{
+    SLCKIT_PROFILE_SCOPE ("Polygon::simplify");
+
+    simplify ();
+
+    const int N (count ());
+    if (N < 3 || ! (tolerance > 0.0))
+    {
+        return;
     }
+
+    const Point *points (constData ());
+    QVector<bool> keep;
+    switch (method)
+    {
+    case DouglasPeucker:
+        douglasPeucker (points, N, tolerance, keep);
+        break;
+    case Visvalingam:
+        visvalingam (points, N, tolerance, isClosed () ? 4 : 2, keep);
+        break;
+    }
+
+    Point *output (data ());
+    int kept (0);
+    for (int i = 0; i < N; ++i)
+    {
+        if (keep.at (i))
+        {
+            output [kept++] = output [i];
+        }
+    }
+    resize (kept);
+}
+
+Polygon Polygon::simplified (qreal tolerance, SimplifyMethod method) const &
+{
+    Polygon other (*this);
+    other.simplify (tolerance, method);
+    return other;
+}
+
+/**
+ * @brief 临时对象上调用时直接在原存储上简化并移出, 不再复制顶点
+ */
+Polygon Polygon::simplified (qreal tolerance, SimplifyMethod method) &&
+{
+    simplify (tolerance, method);
+    return std::move (*this);
 }
 
-Polygon Polygon::simplified() const
+Polygon Polygon::simplified() const &
 {
     Polygon other (*this);
     other.simplify ();
     return other;
 }
 
+Polygon Polygon::simplified() &&
+{
+    simplify ();
+    return std::move (*this);
+}
+
 void Polygon::reverse ()
 {
     std::reverse(this->begin(), this->end());
 }
 
-Polygon Polygon::reversed () const
+Polygon Polygon::reversed () const &
 {
     Polygon other (*this);
     other.reverse();
     return other;
 }
 
+Polygon Polygon::reversed () &&
+{
+    reverse ();
+    return std::move (*this);
+}
+
 void Polygon::close ()
 {
     if (!isClosed())
@@ -73,13 +296,19 @@ void Polygon::close ()
     }
 }
 
-Polygon Polygon::closed () const
+Polygon Polygon::closed () const &
 {
     Polygon other (*this);
     other.close();
     return other;
 }
 
+Polygon Polygon::closed () &&
+{
+    close ();
+    return std::move (*this);
+}
+
 bool Polygon::isClosed () const
 {
     // 空路径亦是闭合的
@@ -89,13 +318,19 @@ bool Polygon::isClosed () const
     return isClosed;
 }
 
-const Polygon Polygon::translated(const Point &offset) const
+Polygon Polygon::translated(const Point &offset) const &
 {
     Polygon other (*this);
     other.translate (offset);
     return other;
 }
 
+Polygon Polygon::translated(const Point &offset) &&
+{
+    translate (offset);
+    return std::move (*this);
+}
+
 void Polygon::translate(const Point &offset)
 {
     if (! offset.isValid ())
@@ -103,20 +338,44 @@ void Polygon::translate(const Point &offset)
         return;
     }
 
-    for (Point &point : *this)
+    translateKernel (data (), count (), offset);
+}
+
+/**
+ * @brief 将多边形视为闭合区域, 向外偏置 distance, distance 为负时向内收缩
+ *
+ * 自交部分按奇偶规则处理. 收缩时区域可能分裂为多个或消失, 因此返回多个多边形:
+ * 外环逆时针, 孔洞顺时针, 均已闭合, 类型同本多边形, z 取第一个顶点的 z.
+ * @param join 尖角的连接方式
+ * @param miterLimit MiterJoin 时尖角长度与 distance 之比的上限, 超过时按 BevelJoin 处理
+ */
+QVector<Polygon> Polygon::offsetted(qreal distance, JoinType join, qreal miterLimit) const
+{
+    QVector<Polygon> polygons;
+    if (count () < 3)
     {
-        point += offset;
+        return polygons;
     }
+
+    const IntRings rings (offsetRings (IntRings () << toIntRing (*this),
+                                       distance * planarScale,
+                                       join,
+                                       miterLimit,
+                                       planarArcTolerance));
+    polygons.reserve (rings.count ());
+    for (const IntRing &ring : rings)
+    {
+        polygons.append (toPolygon (ring, first ().z (), m_type));
+    }
+    return polygons;
 }
 
 const Boundary Polygon::boundary() const
 {
-    Boundary boundary;
-    for (const Point &point : *this)
-    {
-        boundary.refer (point);
-    }
-    return boundary;
+    qreal lower [3] = {INFINITY, INFINITY, INFINITY};
+    qreal upper [3] = {-INFINITY, -INFINITY, -INFINITY};
+    boundaryKernel (constData (), count (), lower, upper);
+    return kernelBoundary (lower, upper);
 }
 
 // Code below adopted from
@@ -134,13 +393,7 @@ qreal Polygon::area() const
         return area;
     }
 
-    for (int i = 0; i < N - 1; ++i)
-    {
-        const Point &p0 ((*this) [i]);
-        const Point &p1 ((*this) [(i + 1) % N]);
-        area += p0.x () * p1.y () - p1.x () * p0.y ();
-    }
-
+    area = crossSumKernel (constData (), N);
     area /= 2.0;
 
     return area;
@@ -0,0 +1,419 @@
+﻿#include "profiling.h"
+
+const QString Profiler::counterName (Counter counter)
+{
+    switch (counter)
+    {
+    case BytesRead:
+        return QStringLiteral ("BytesRead");
+    case BytesWritten:
+        return QStringLiteral ("BytesWritten");
+    case Layers:
+        return QStringLiteral ("Layers");
+    case Polygons:
+        return QStringLiteral ("Polygons");
+    case Vertices:
+        return QStringLiteral ("Vertices");
+    case Allocations:
+        return QStringLiteral ("Allocations");
+    default:
+        break;
+    }
+    return QString ();
+}
+
+#ifdef SLCKIT_PROFILING
+
+#include <QMutex>
+#include <QSaveFile>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+const int MaxStages = 256;
+
+// about 100 MB of events, later calls are only counted as dropped
+const int MaxTraceEvents = 1 << 22;
+
+class StageData
+{
+public:
+    const char *name = nullptr;
+    std::atomic<quint64> calls {0};
+    std::atomic<quint64> totalTime {0};
+    std::atomic<quint64> maxTime {0};
+};
+
+class TraceEvent
+{
+public:
+    int stage;
+    int thread;
+    quint64 start;
+    quint64 duration;
+};
+
+class ThreadCounters;
+
+class Registry
+{
+public:
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now ();
+
+    QMutex mutex;
+    StageData stages [MaxStages];
+    std::atomic<int> stageCount {0};
+    std::atomic<int> threadCount {0};
+
+    // counters of exited threads, and the totals at the last reset ()
+    QVector<ThreadCounters *> threads;
+    quint64 finished [Profiler::CounterCount] = {};
+    quint64 baseline [Profiler::CounterCount] = {};
+
+    std::atomic<bool> tracing {false};
+    QMutex traceMutex;
+    QVector<TraceEvent> events;
+    quint64 droppedEvents = 0;
+};
+
+Registry &registry ()
+{
+    static Registry instance;
+    return instance;
+}
+
+/**
+ * @brief 单个线程的计数器, 只由所属线程写入, 无需原子的读-改-写
+ *
+ * 其它线程读取时加锁遍历所有线程的计数器, 线程退出时将计数并入 Registry::finished.
+ */
+class ThreadCounters
+{
+public:
+    ThreadCounters ()
+    {
+        for (std::atomic<quint64> &value : values)
+        {
+            value.store (0, std::memory_order_relaxed);
+        }
+
+        Registry &shared (registry ());
+        QMutexLocker locker (&shared.mutex);
+        shared.threads.append (this);
+    }
+
+    ~ThreadCounters ()
+    {
+        Registry &shared (registry ());
+        QMutexLocker locker (&shared.mutex);
+        for (int i = 0; i < Profiler::CounterCount; ++i)
+        {
+            shared.finished [i] += values [i].load (std::memory_order_relaxed);
+        }
+        shared.threads.removeOne (this);
+    }
+
+    std::atomic<quint64> values [Profiler::CounterCount];
+};
+
+int threadId ()
+{
+    static thread_local const int id (registry ().threadCount.fetch_add (1));
+    return id;
+}
+
+// total of counter since the process started, requires registry ().mutex
+quint64 counterTotal (int counter)
+{
+    const Registry &shared (registry ());
+    quint64 total (shared.finished [counter]);
+    for (const ThreadCounters *counters : shared.threads)
+    {
+        total += counters->values [counter].load (std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void appendMicroseconds (QByteArray &json, quint64 nanoseconds)
+{
+    char text [32];
+    std::snprintf (text, sizeof (text), "%llu.%03llu",
+                   (unsigned long long) (nanoseconds / 1000),
+                   (unsigned long long) (nanoseconds % 1000));
+    json.append (text);
+}
+
+void appendString (QByteArray &json, const char *text)
+{
+    json.append ('"');
+    for (; *text != '\0'; ++text)
+    {
+        if (*text == '"' || *text == '\\')
+        {
+            json.append ('\\');
+        }
+        json.append (*text);
+    }
+    json.append ('"');
+}
+
+} // namespace
+
+/**
+ * @brief 返回名为 name 的阶段编号, 同名的埋点共用一个阶段
+ * @return 阶段数超出上限时返回 -1, 该埋点不再记录
+ */
+int profileStage (const char *name)
+{
+    Registry &shared (registry ());
+    QMutexLocker locker (&shared.mutex);
+
+    const int count (shared.stageCount.load ());
+    for (int stage = 0; stage < count; ++stage)
+    {
+        if (std::strcmp (shared.stages [stage].name, name) == 0)
+        {
+            return stage;
+        }
+    }
+
+    if (count >= MaxStages)
+    {
+        return -1;
+    }
+    shared.stages [count].name = name;
+    shared.stageCount.store (count + 1);
+    return count;
+}
+
+/**
+ * @brief 自 Registry 建立起的纳秒数
+ */
+quint64 profileClock ()
+{
+    return quint64 (std::chrono::duration_cast<std::chrono::nanoseconds> (
+                        std::chrono::steady_clock::now () - registry ().epoch).count ());
+}
+
+void profileRecord (int stage, quint64 start)
+{
+    if (stage < 0)
+    {
+        return;
+    }
+
+    const quint64 duration (profileClock () - start);
+    Registry &shared (registry ());
+    StageData &data (shared.stages [stage]);
+    data.calls.fetch_add (1, std::memory_order_relaxed);
+    data.totalTime.fetch_add (duration, std::memory_order_relaxed);
+    quint64 maxTime (data.maxTime.load (std::memory_order_relaxed));
+    while (duration > maxTime &&
+           ! data.maxTime.compare_exchange_weak (maxTime, duration, std::memory_order_relaxed))
+    {}
+
+    if (shared.tracing.load (std::memory_order_relaxed))
+    {
+        const int thread (threadId ());
+        QMutexLocker locker (&shared.traceMutex);
+        if (shared.events.count () < MaxTraceEvents)
+        {
+            shared.events.append (TraceEvent {stage, thread, start, duration});
+        }
+        else
+        {
+            ++shared.droppedEvents;
+        }
+    }
+}
+
+void profileCount (Profiler::Counter counter, quint64 value)
+{
+    static thread_local ThreadCounters counters;
+    std::atomic<quint64> &total (counters.values [counter]);
+    total.store (total.load (std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+bool Profiler::isEnabled ()
+{
+    return true;
+}
+
+/**
+ * @brief 清零所有阶段与计数器, 并丢弃已记录的 trace 事件
+ */
+void Profiler::reset ()
+{
+    Registry &shared (registry ());
+    {
+        QMutexLocker locker (&shared.mutex);
+        for (int stage = 0; stage < shared.stageCount.load (); ++stage)
+        {
+            shared.stages [stage].calls.store (0);
+            shared.stages [stage].totalTime.store (0);
+            shared.stages [stage].maxTime.store (0);
+        }
+        for (int i = 0; i < CounterCount; ++i)
+        {
+            shared.baseline [i] = counterTotal (i);
+        }
+    }
+
+    QMutexLocker locker (&shared.traceMutex);
+    shared.events.clear ();
+    shared.droppedEvents = 0;
+}
+
+quint64 Profiler::counter (Counter counter)
+{
+    if (counter < 0 || counter >= CounterCount)
+    {
+        return 0;
+    }
+
+    Registry &shared (registry ());
+    QMutexLocker locker (&shared.mutex);
+    return counterTotal (counter) - shared.baseline [counter];
+}
+
+/**
+ * @brief 自上次 reset () 以来至少调用过一次的阶段, 按首次出现的顺序排列
+ */
+const QVector<Profiler::Stage> Profiler::stages ()
+{
+    QVector<Stage> result;
+    Registry &shared (registry ());
+    const int count (shared.stageCount.load ());
+    for (int stage = 0; stage < count; ++stage)
+    {
+        const StageData &data (shared.stages [stage]);
+        if (data.calls.load () == 0)
+        {
+            continue;
+        }
+
+        Stage entry;
+        entry.name = QString::fromLatin1 (data.name);
+        entry.calls = data.calls.load ();
+        entry.totalTime = data.totalTime.load ();
+        entry.maxTime = data.maxTime.load ();
+        result.append (entry);
+    }
+    return result;
+}
+
+/**
+ * @brief 是否记录每一次阶段调用, 供 saveTrace () 使用
+ *
+ * 记录 trace 时每次调用都要加锁追加事件, 开销明显高于只累计耗时.
+ */
+void Profiler::setTracing (bool enabled)
+{
+    registry ().tracing.store (enabled);
+}
+
+bool Profiler::isTracing ()
+{
+    return registry ().tracing.load ();
+}
+
+/**
+ * @brief 将已记录的阶段调用保存为 Chrome trace event 格式的 JSON
+ *
+ * 每次调用为一个 "X" 事件, 时间单位为微秒, tid 为线程的编号.
+ * 最后附加一个 "C" 事件记录保存时的各计数器.
+ */
+bool Profiler::saveTrace (const QString &filename)
+{
+    Registry &shared (registry ());
+    QByteArray json ("{\"traceEvents\":[\n");
+    quint64 end (profileClock ());
+    {
+        QMutexLocker locker (&shared.traceMutex);
+        for (const TraceEvent &event : shared.events)
+        {
+            json.append ("{\"name\":");
+            appendString (json, shared.stages [event.stage].name);
+            json.append (",\"cat\":\"slckit\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+            json.append (QByteArray::number (event.thread));
+            json.append (",\"ts\":");
+            appendMicroseconds (json, event.start);
+            json.append (",\"dur\":");
+            appendMicroseconds (json, event.duration);
+            json.append ("},\n");
+        }
+        json.append ("{\"name\":\"counters\",\"cat\":\"slckit\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":");
+        appendMicroseconds (json, end);
+        json.append (",\"args\":{");
+        for (int i = 0; i < CounterCount; ++i)
+        {
+            json.append (i == 0 ? "\"" : ",\"");
+            json.append (counterName (Counter (i)).toLatin1 ());
+            json.append ("\":");
+            json.append (QByteArray::number (counter (Counter (i))));
+        }
+        json.append ("}}\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":");
+        json.append (QByteArray::number (shared.droppedEvents));
+        json.append ("}}\n");
+    }
+
+    bool ok (false);
+    do
+    {
+        QSaveFile file (filename);
+        if (! file.open (QIODevice::WriteOnly))
+        {
+            break;
+        }
+        if (file.write (json) != json.size ())
+        {
+            break;
+        }
+        ok = file.commit ();
+    }
+    while (false);
+    return ok;
+}
+
+#else
+
+bool Profiler::isEnabled ()
+{
+    return false;
+}
+
+void Profiler::reset ()
+{}
+
+quint64 Profiler::counter (Counter counter)
+{
+    Q_UNUSED (counter);
+    return 0;
+}
+
+const QVector<Profiler::Stage> Profiler::stages ()
+{
+    return QVector<Stage> ();
+}
+
+void Profiler::setTracing (bool enabled)
+{
+    Q_UNUSED (enabled);
+}
+
+bool Profiler::isTracing ()
+{
+    return false;
+}
+
+bool Profiler::saveTrace (const QString &filename)
+{
+    Q_UNUSED (filename);
+    return false;
+}
+
+#endif
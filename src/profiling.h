@@ -0,0 +1,50 @@
+﻿#ifndef PROFILING_H
+#define PROFILING_H
+
+#include "profiler.h"
+
+// Instrumentation points used inside the library. Without SLCKIT_PROFILING
+// both macros expand to empty statements and their arguments are not evaluated.
+//
+//   SLCKIT_PROFILE_SCOPE ("Model::sort");        times the rest of the enclosing block
+//   SLCKIT_PROFILE_COUNT (Vertices, count);      adds count to Profiler::Vertices
+
+#ifdef SLCKIT_PROFILING
+
+int profileStage (const char *name);
+quint64 profileClock ();
+void profileRecord (int stage, quint64 start);
+void profileCount (Profiler::Counter counter, quint64 value);
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope (int stage) :
+        m_stage (stage), m_start (profileClock ())
+    {}
+
+    ~ProfileScope ()
+    {
+        profileRecord (m_stage, m_start);
+    }
+
+private:
+    int m_stage;
+    quint64 m_start;
+};
+
+#define SLCKIT_PROFILE_SCOPE(name) \
+    static const int slckitProfileStage (profileStage (name)); \
+    const ProfileScope slckitProfileScope (slckitProfileStage)
+
+#define SLCKIT_PROFILE_COUNT(counter, value) \
+    profileCount (Profiler::counter, quint64 (value))
+
+#else
+
+#define SLCKIT_PROFILE_SCOPE(name) do {} while (false)
+#define SLCKIT_PROFILE_COUNT(counter, value) do {} while (false)
+
+#endif
+
+#endif // PROFILING_H
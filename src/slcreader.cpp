@@ -0,0 +1,779 @@
+﻿#include "slcreader.h"
+#include "profiling.h"
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+static inline quint32 readUInt32 (const uchar *data)
+{
+    return qFromLittleEndian<quint32> (data);
+}
+
+static inline float readFloat (const uchar *data)
+{
+    quint32 bits (readUInt32 (data));
+    float value;
+    std::memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+
+// a decoded polygon must fit into a QVector<Point>, which also keeps the raw vertices of
+// SLCStreamReader within a QByteArray; both readers reject larger polygons as corrupt
+static const quint32 maxVertexCount (quint32 (0x7fff0000 / sizeof (Point)));
+
+static inline void readPoints (const uchar *data, quint32 count, qreal unitScale, Point *point)
+{
+    for (quint32 verticeId = 0; verticeId < count; ++verticeId)
+    {
+        point [verticeId].setValue (readFloat (data) * unitScale,
+                                    readFloat (data + 4) * unitScale,
+                                    0.0);
+        data += 8;
+    }
+}
+
+static inline void readPoints (const uchar *data, quint32 count, qreal unitScale, float *x, float *y)
+{
+    for (quint32 verticeId = 0; verticeId < count; ++verticeId)
+    {
+        x [verticeId] = float (readFloat (data) * unitScale);
+        y [verticeId] = float (readFloat (data + 4) * unitScale);
+        data += 8;
+    }
+}
+
+/**
+ * @brief 解析 SLC 文件头, 保留段及采样表
+ * @param data 文件起始处的数据
+ * @param size data 的字节数
+ * @param contourOffset 返回轮廓数据段相对文件起始的偏移
+ * @return 文件头有效且完整时返回 true
+ */
+static bool readSLCHeader (const uchar *data,
+                           qint64 size,
+                           qint64 &contourOffset,
+                           qreal &version,
+                           qreal &unitScale,
+                           Polygon::PolygonType &polygonType)
+{
+    SLCKIT_PROFILE_SCOPE ("readSLCHeader");
+
+    /****************************************************************/
+    /*-----------------------header section-------------------------*/
+    /****************************************************************/
+    qint64 offset (0);
+    QByteArray headerData;
+    while (offset < size)
+    {
+        char headerChar (data [offset++]);
+        if (headerChar == 0x0d && offset < size)
+        {
+            headerChar = data [offset++];
+            if (headerChar == 0x0a && offset < size)
+            {
+                headerChar = data [offset++];
+                if (headerChar == 0x1a)
+                {
+                    // break header reading
+                    break;
+                }
+            }
+        }
+        headerData.append (headerChar);
+    }
+
+    // split header with whitespace
+    QList <QByteArray> headerList (headerData.split (' '));
+
+    // extract SLCVER, UNIT, TYPE info in the header
+    int versionIndex (headerList.indexOf ("-SLCVER"));
+    int unitIndex (headerList.indexOf ("-UNIT"));
+    int typeIndex (headerList.indexOf ("-TYPE"));
+
+    if (versionIndex < 0 || unitIndex < 0 || typeIndex < 0 ||
+        versionIndex + 1 >= headerList.count () ||
+        unitIndex + 1 >= headerList.count () ||
+        typeIndex + 1 >= headerList.count ())
+    {
+        return false;
+    }
+
+    QByteArray versionString (headerList.at (versionIndex + 1));
+    QByteArray unitString (headerList.at (unitIndex + 1));
+    QByteArray typeString (headerList.at (typeIndex + 1));
+
+    // requires SLCVER >= 2.0 to proceed, as Model::readSLC does
+    version = versionString.toDouble ();
+    if (version < 2.0)
+    {
+        return false;
+    }
+
+    unitScale = 1.0;
+    if (unitString != "MM")
+    {
+        unitScale = 2.54;
+    }
+
+    polygonType = Polygon::Support;
+    if (typeString == "PART")
+    {
+        polygonType = Polygon::Contour;
+    }
+
+    /****************************************************************/
+    /*-----------------------reserve section------------------------*/
+    /****************************************************************/
+    offset += 256;
+
+    /****************************************************************/
+    /*-----------------------sampling table*------------------------*/
+    /****************************************************************/
+    if (offset >= size)
+    {
+        return false;
+    }
+    quint8 samplingTableSize (data [offset++]);
+    offset += qint64 (samplingTableSize) * sizeof (float) * 4;
+    if (offset > size)
+    {
+        return false;
+    }
+
+    contourOffset = offset;
+    return true;
+}
+
+SLCReader::SLCReader ()
+{}
+
+SLCReader::~SLCReader ()
+{
+    close ();
+}
+
+bool SLCReader::open (const QString &filename)
+{
+    close ();
+
+    bool ok (false);
+    do
+    {
+        if (filename.isEmpty ())
+        {
+            break;
+        }
+
+        m_file.setFileName (filename);
+        if (! m_file.open (QIODevice::ReadOnly))
+        {
+            break;
+        }
+
+        m_size = m_file.size ();
+        if (m_size <= 0)
+        {
+            break;
+        }
+
+        m_data = m_file.map (0, m_size);
+        if (m_data == nullptr)
+        {
+            break;
+        }
+
+        if (! readHeader ())
+        {
+            break;
+        }
+
+        ok = true;
+    }
+    while (false);
+
+    if (! ok)
+    {
+        close ();
+    }
+    return ok;
+}
+
+void SLCReader::close ()
+{
+    if (m_data != nullptr)
+    {
+        m_file.unmap (const_cast<uchar *> (m_data));
+        m_data = nullptr;
+    }
+    m_file.close ();
+
+    m_size = 0;
+    m_contourOffset = 0;
+    m_version = 0.0;
+    m_unitScale = 1.0;
+    m_polygonType = Polygon::Contour;
+}
+
+bool SLCReader::isOpen () const
+{
+    return (m_data != nullptr);
+}
+
+qreal SLCReader::version () const
+{
+    return m_version;
+}
+
+qreal SLCReader::unitScale () const
+{
+    return m_unitScale;
+}
+
+Polygon::PolygonType SLCReader::polygonType () const
+{
+    return m_polygonType;
+}
+
+qint64 SLCReader::size () const
+{
+    return m_size;
+}
+
+qint64 SLCReader::contourOffset () const
+{
+    return m_contourOffset;
+}
+
+bool SLCReader::readHeader ()
+{
+    return readSLCHeader (m_data, m_size, m_contourOffset, m_version, m_unitScale, m_polygonType);
+}
+
+/**
+ * @brief 快速扫描轮廓数据段, 只读取各层记录中的数量字段而跳过顶点数据
+ * @return 按文件顺序排列的完整层记录, 遇到结束标记或不完整的记录时停止
+ */
+const QVector<SLCReader::LayerRecord> SLCReader::scan () const
+{
+    SLCKIT_PROFILE_SCOPE ("SLCReader::scan");
+
+    QVector<LayerRecord> records;
+    qint64 offset (m_contourOffset);
+
+    while (m_data != nullptr && m_size - offset >= 8)
+    {
+        LayerRecord record;
+        record.offset = offset;
+
+        float minZLevel (readFloat (m_data + offset));
+        quint32 numberOfBoundary (readUInt32 (m_data + offset + 4));
+        offset += 8;
+
+        if (numberOfBoundary == 0xFFFFFFFF)
+        {
+            break;
+        }
+
+        bool complete (true);
+        for (quint32 boundaryId = 0; boundaryId < numberOfBoundary; ++boundaryId)
+        {
+            if (m_size - offset < 8)
+            {
+                complete = false;
+                break;
+            }
+
+            quint32 numberOfVertices (readUInt32 (m_data + offset));
+            offset += 8;
+
+            if (quint64 (numberOfVertices) * 8 > quint64 (m_size - offset))
+            {
+                complete = false;
+                break;
+            }
+            offset += qint64 (numberOfVertices) * 8;
+            record.vertexCount += numberOfVertices;
+        }
+
+        if (! complete)
+        {
+            break;
+        }
+
+        record.height = minZLevel * m_unitScale;
+        record.polygonCount = numberOfBoundary;
+        records.append (record);
+    }
+    return records;
+}
+
+namespace
+{
+
+/**
+ * @brief decodeLayer 的解码目标, 写入 Layer
+ */
+class LayerTarget
+{
+public:
+    explicit LayerTarget (Layer &layer) : m_layer (layer) {}
+
+    bool resize (quint32 polygonCount)
+    {
+        if (m_layer.capacity () < int (polygonCount))
+        {
+            SLCKIT_PROFILE_COUNT (Allocations, 1);
+        }
+        m_layer.resize (int (polygonCount));
+        return true;
+    }
+
+    bool setPolygon (quint32 index, quint32 vertexCount, Polygon::PolygonType type, const uchar *data, qreal unitScale)
+    {
+        Polygon &polygon (m_layer [int (index)]);
+        if (polygon.capacity () < int (vertexCount))
+        {
+            SLCKIT_PROFILE_COUNT (Allocations, 1);
+        }
+        polygon.resize (int (vertexCount));
+        readPoints (data, vertexCount, unitScale, polygon.data ());
+        polygon.setType (type);
+        return true;
+    }
+
+    bool finish (qreal height)
+    {
+        m_layer.setHeight (height);
+        return true;
+    }
+
+private:
+    Layer &m_layer;
+};
+
+/**
+ * @brief decodeLayer 的解码目标, 写入 CompactLayer
+ */
+class CompactLayerTarget
+{
+public:
+    explicit CompactLayerTarget (CompactLayer &layer) : m_layer (layer) {}
+
+    bool resize (quint32 polygonCount)
+    {
+        m_layer.resize (int (polygonCount));
+        return true;
+    }
+
+    bool setPolygon (quint32 index, quint32 vertexCount, Polygon::PolygonType type, const uchar *data, qreal unitScale)
+    {
+        CompactPolygon &polygon (m_layer [int (index)]);
+        polygon.resize (int (vertexCount));
+        readPoints (data, vertexCount, unitScale, polygon.xData (), polygon.yData ());
+        polygon.setType (type);
+        return true;
+    }
+
+    bool finish (qreal height)
+    {
+        m_layer.setHeight (height);
+        m_layer.setZ (0.0);
+        return true;
+    }
+
+private:
+    CompactLayer &m_layer;
+};
+
+/**
+ * @brief decodeLayer 的解码目标, 写入 PackedModel 中一层预先分配的区间, 数量须与区间相符
+ */
+class PackedLayerTarget
+{
+public:
+    PackedLayerTarget (PackedModel &model, int index) :
+        m_layer (model.layerData () [index]),
+        m_polygons (model.polygonData () + m_layer.firstPolygon),
+        m_points (model.pointData ()),
+        m_vertex (m_layer.firstVertex)
+    {}
+
+    bool resize (quint32 polygonCount)
+    {
+        return (qint64 (polygonCount) == m_layer.polygonCount);
+    }
+
+    bool setPolygon (quint32 index, quint32 vertexCount, Polygon::PolygonType type, const uchar *data, qreal unitScale)
+    {
+        if (qint64 (vertexCount) > m_layer.firstVertex + m_layer.vertexCount - m_vertex)
+        {
+            return false;
+        }
+
+        PackedModel::PolygonRange &polygon (m_polygons [index]);
+        polygon.firstVertex = m_vertex;
+        polygon.vertexCount = vertexCount;
+        polygon.type = type;
+        readPoints (data, vertexCount, unitScale, m_points + m_vertex);
+        m_vertex += vertexCount;
+        return true;
+    }
+
+    bool finish (qreal height)
+    {
+        m_layer.height = height;
+        return (m_vertex == m_layer.firstVertex + m_layer.vertexCount);
+    }
+
+private:
+    PackedModel::LayerRange &m_layer;
+    PackedModel::PolygonRange *m_polygons;
+    Point *m_points;
+    qint64 m_vertex;
+};
+
+}
+
+/**
+ * @brief 解码映射内存 [data, data + size) 中 offset 处的一个层记录, 各 readLayer 共用
+ *
+ * Target 依次收到 resize (多边形数), 每个多边形的 setPolygon (序号, 顶点数, 类型, 顶点数据, 单位比例)
+ * 及 finish (层高), 任一返回 false 时解码失败.
+ * @param offset 层记录的起始偏移, 成功时前进至下一层记录
+ * @return 遇到结束标记, 数据不完整或与 Target 不符时返回 false
+ */
+template <class Target>
+static bool decodeLayer (const uchar *data,
+                         qint64 size,
+                         qint64 &offset,
+                         qreal unitScale,
+                         Polygon::PolygonType type,
+                         Target &target)
+{
+    const uchar *cursor (data + offset);
+    const uchar *end (data + size);
+
+    float minZLevel (readFloat (cursor));
+    quint32 numberOfBoundary (readUInt32 (cursor + 4));
+    cursor += 8;
+
+    //judge for termination
+    if (numberOfBoundary == 0xFFFFFFFF)
+    {
+        return false;
+    }
+
+    // every boundary carries at least its vertex and gap counts
+    if (quint64 (numberOfBoundary) * 8 > quint64 (end - cursor) || ! target.resize (numberOfBoundary))
+    {
+        return false;
+    }
+
+    for (quint32 boundaryId = 0; boundaryId < numberOfBoundary; ++boundaryId)
+    {
+        if (end - cursor < 8)
+        {
+            return false;
+        }
+        quint32 numberOfVertices (readUInt32 (cursor));
+        cursor += 8;
+
+        if (numberOfVertices > maxVertexCount ||
+            quint64 (numberOfVertices) * 8 > quint64 (end - cursor) ||
+            ! target.setPolygon (boundaryId, numberOfVertices, type, cursor, unitScale))
+        {
+            return false;
+        }
+        cursor += qint64 (numberOfVertices) * 8;
+        SLCKIT_PROFILE_COUNT (Vertices, numberOfVertices);
+    }
+    if (! target.finish (minZLevel * unitScale))
+    {
+        return false;
+    }
+
+    SLCKIT_PROFILE_COUNT (BytesRead, cursor - data - offset);
+    SLCKIT_PROFILE_COUNT (Layers, 1);
+    SLCKIT_PROFILE_COUNT (Polygons, numberOfBoundary);
+    offset = cursor - data;
+    return true;
+}
+
+/**
+ * @brief 从映射内存中解码 offset 处的一个层记录
+ * @param offset 层记录的起始偏移, 成功时前进至下一层记录
+ * @param layer 解码结果, 多边形及顶点存储按记录中的数量一次性分配
+ * @return 成功解码返回 true, 遇到结束标记或数据不完整时返回 false
+ */
+bool SLCReader::readLayer (qint64 &offset, Layer &layer) const
+{
+    SLCKIT_PROFILE_SCOPE ("SLCReader::readLayer");
+
+    if (m_data == nullptr || offset < m_contourOffset || m_size - offset < 8)
+    {
+        return false;
+    }
+
+    LayerTarget target (layer);
+    return decodeLayer (m_data, m_size, offset, m_unitScale, m_polygonType, target);
+}
+
+/**
+ * @brief 与 readLayer (qint64 &, Layer &) 相同, 但直接解码为紧凑存储
+ */
+bool SLCReader::readLayer (qint64 &offset, CompactLayer &layer) const
+{
+    SLCKIT_PROFILE_SCOPE ("SLCReader::readLayer");
+
+    if (m_data == nullptr || offset < m_contourOffset || m_size - offset < 8)
+    {
+        return false;
+    }
+
+    CompactLayerTarget target (layer);
+    return decodeLayer (m_data, m_size, offset, m_unitScale, m_polygonType, target);
+}
+
+/**
+ * @brief 将 offset 处的层记录解码到 model 第 index 层预先分配的区间中
+ *
+ * 该层的 firstPolygon, polygonCount, firstVertex 与 vertexCount 须已按 scan () 的结果填好,
+ * 函数填写层高, 各多边形的区间与顶点. 不同的层可在不同线程中同时解码.
+ * @return 记录与预先分配的数量不符或数据不完整时返回 false
+ */
+bool SLCReader::readLayer (qint64 &offset, PackedModel &model, int index) const
+{
+    SLCKIT_PROFILE_SCOPE ("SLCReader::readLayer");
+
+    if (m_data == nullptr || offset < m_contourOffset || m_size - offset < 8 ||
+        index < 0 || index >= model.count ())
+    {
+        return false;
+    }
+
+    PackedLayerTarget target (model, index);
+    return decodeLayer (m_data, m_size, offset, m_unitScale, m_polygonType, target);
+}
+
+SLCStreamReader::SLCStreamReader ()
+{}
+
+SLCStreamReader::~SLCStreamReader ()
+{
+    close ();
+}
+
+bool SLCStreamReader::open (const QString &filename)
+{
+    close ();
+
+    bool ok (false);
+    do
+    {
+        if (filename.isEmpty ())
+        {
+            break;
+        }
+
+        m_file.setFileName (filename);
+        if (! m_file.open (QIODevice::ReadOnly))
+        {
+            break;
+        }
+        m_size = m_file.size ();
+
+        // header (at most 2048 bytes), reserved section and a full sampling table
+        const qint64 headerSize (8192);
+        QByteArray header (m_file.read (headerSize));
+
+        qint64 contourOffset (0);
+        if (! readSLCHeader ((const uchar *) header.constData (),
+                             header.size (),
+                             contourOffset,
+                             m_version,
+                             m_unitScale,
+                             m_polygonType))
+        {
+            break;
+        }
+
+        if (! m_file.seek (contourOffset))
+        {
+            break;
+        }
+
+        m_atEnd = false;
+        ok = true;
+    }
+    while (false);
+
+    if (! ok)
+    {
+        close ();
+    }
+    return ok;
+}
+
+void SLCStreamReader::close ()
+{
+    m_file.close ();
+    m_size = 0;
+    m_buffer.clear ();
+    m_layer.clear ();
+    m_atEnd = true;
+
+    m_version = 0.0;
+    m_unitScale = 1.0;
+    m_polygonType = Polygon::Contour;
+}
+
+bool SLCStreamReader::isOpen () const
+{
+    return m_file.isOpen ();
+}
+
+bool SLCStreamReader::atEnd () const
+{
+    return m_atEnd;
+}
+
+qreal SLCStreamReader::version () const
+{
+    return m_version;
+}
+
+qreal SLCStreamReader::unitScale () const
+{
+    return m_unitScale;
+}
+
+Polygon::PolygonType SLCStreamReader::polygonType () const
+{
+    return m_polygonType;
+}
+
+bool SLCStreamReader::readRaw (char *data, qint64 size)
+{
+    const qint64 read (m_file.read (data, size));
+    SLCKIT_PROFILE_COUNT (BytesRead, std::max (read, qint64 (0)));
+    return (read == size);
+}
+
+/**
+ * @brief 读取下一层, layer 中已有的多边形及顶点存储会被复用
+ * @return 成功读取返回 true, 遇到结束标记, 文件结束或数据不完整时返回 false
+ */
+bool SLCStreamReader::readNext (Layer &layer)
+{
+    SLCKIT_PROFILE_SCOPE ("SLCStreamReader::readNext");
+
+    if (m_atEnd)
+    {
+        return false;
+    }
+
+    bool ok (false);
+    do
+    {
+        uchar record [8];
+        if (! readRaw ((char *) record, sizeof (record)))
+        {
+            break;
+        }
+
+        float minZLevel (readFloat (record));
+        quint32 numberOfBoundary (readUInt32 (record + 4));
+
+        //judge for termination
+        if (numberOfBoundary == 0xFFFFFFFF)
+        {
+            break;
+        }
+
+        // every boundary carries at least its vertex and gap counts
+        if (quint64 (numberOfBoundary) * 8 > quint64 (m_size - m_file.pos ()))
+        {
+            break;
+        }
+
+        if (layer.capacity () < int (numberOfBoundary))
+        {
+            SLCKIT_PROFILE_COUNT (Allocations, 1);
+        }
+        layer.resize (int (numberOfBoundary));
+
+        bool complete (true);
+        for (Polygon &polygon : layer)
+        {
+            if (! readRaw ((char *) record, sizeof (record)))
+            {
+                complete = false;
+                break;
+            }
+
+            quint32 numberOfVertices (readUInt32 (record));
+            qint64 vertexBytes (qint64 (numberOfVertices) * 8);
+            if (numberOfVertices > maxVertexCount || vertexBytes > m_size - m_file.pos ())
+            {
+                complete = false;
+                break;
+            }
+
+            if (m_buffer.size () < vertexBytes)
+            {
+                m_buffer.resize (int (vertexBytes));
+                SLCKIT_PROFILE_COUNT (Allocations, 1);
+            }
+            if (! readRaw (m_buffer.data (), vertexBytes))
+            {
+                complete = false;
+                break;
+            }
+
+            if (polygon.capacity () < int (numberOfVertices))
+            {
+                SLCKIT_PROFILE_COUNT (Allocations, 1);
+            }
+            polygon.resize (int (numberOfVertices));
+            readPoints ((const uchar *) m_buffer.constData (), numberOfVertices, m_unitScale, polygon.data ());
+            polygon.setType (m_polygonType);
+            SLCKIT_PROFILE_COUNT (Vertices, numberOfVertices);
+        }
+
+        if (! complete)
+        {
+            break;
+        }
+
+        layer.setHeight (minZLevel * m_unitScale);
+        SLCKIT_PROFILE_COUNT (Layers, 1);
+        SLCKIT_PROFILE_COUNT (Polygons, numberOfBoundary);
+        ok = true;
+    }
+    while (false);
+
+    if (! ok)
+    {
+        m_atEnd = true;
+    }
+    return ok;
+}
+
+/**
+ * @brief 按文件顺序对每一层调用 callback, 各层共用同一块存储
+ * @param callback 返回 false 时停止读取
+ * @return 已交给 callback 的层数
+ */
+int SLCStreamReader::forEachLayer (const std::function<bool (const Layer &layer)> &callback)
+{
+    int count (0);
+    while (readNext (m_layer))
+    {
+        ++count;
+        if (! callback (m_layer))
+        {
+            break;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,278 @@
+﻿#include "slcwriter.h"
+#include "profiling.h"
+#include <QtEndian>
+#include <cstring>
+
+// vertices are encoded into the buffer and written once it holds this many bytes
+static const qint64 FlushSize = 1 << 20;
+
+static inline void writeUInt32 (uchar *data, quint32 value)
+{
+    qToLittleEndian<quint32> (value, data);
+}
+
+static inline void writeFloat (uchar *data, float value)
+{
+    quint32 bits;
+    std::memcpy (&bits, &value, sizeof (bits));
+    writeUInt32 (data, bits);
+}
+
+SLCWriter::SLCWriter ()
+{}
+
+SLCWriter::~SLCWriter ()
+{
+    close ();
+}
+
+bool SLCWriter::open (const QString &filename)
+{
+    return open (filename, Header ());
+}
+
+/**
+ * @brief 创建文件并写出文件头, 保留段与采样表
+ * @param header type 为 Contour 时 -TYPE 为 PART, 否则为 SUPPORT; extents 有效时写出 -EXTENTS
+ */
+bool SLCWriter::open (const QString &filename, const Header &header)
+{
+    close ();
+
+    bool ok (false);
+    do
+    {
+        if (filename.isEmpty ())
+        {
+            break;
+        }
+
+        m_file.setFileName (filename);
+        if (! m_file.open (QIODevice::WriteOnly))
+        {
+            break;
+        }
+
+        /****************************************************************/
+        /*-----------------------header section-------------------------*/
+        /****************************************************************/
+        QString text (QStringLiteral ("-SLCVER 2.0 -UNIT MM -TYPE "));
+        text.append (header.type == Polygon::Contour ? QStringLiteral ("PART") : QStringLiteral ("SUPPORT"));
+        text.append (QStringLiteral (" -PACKAGE SLCKit"));
+        if (header.extents.isValid ())
+        {
+            text.append (QStringLiteral (" -EXTENTS %1,%2 %3,%4 %5,%6")
+                         .arg (header.extents.minX ()).arg (header.extents.maxX ())
+                         .arg (header.extents.minY ()).arg (header.extents.maxY ())
+                         .arg (header.extents.minZ ()).arg (header.extents.maxZ ()));
+        }
+        QByteArray headerData (text.toLatin1 ());
+        headerData.append ("\r\n\x1a", 3);
+
+        /****************************************************************/
+        /*-----------------------reserve section------------------------*/
+        /****************************************************************/
+        headerData.append (QByteArray (256, '\0'));
+
+        /****************************************************************/
+        /*-----------------------sampling table*------------------------*/
+        /****************************************************************/
+        uchar table [1 + 4 * sizeof (float)];
+        table [0] = 1;
+        writeFloat (table + 1, float (header.minZ));
+        writeFloat (table + 5, float (header.thickness));
+        writeFloat (table + 9, float (header.lineWidthCompensation));
+        writeFloat (table + 13, 0.0f);
+        headerData.append (reinterpret_cast<const char *> (table), sizeof (table));
+
+        if (m_file.write (headerData) != headerData.size ())
+        {
+            break;
+        }
+
+        m_buffer.resize (int (FlushSize));
+        m_used = 0;
+        m_layerCount = 0;
+        m_lastZ = float (header.minZ);
+        ok = true;
+    }
+    while (false);
+
+    m_ok = ok;
+    if (! ok)
+    {
+        m_file.close ();
+    }
+    return ok;
+}
+
+/**
+ * @brief 写出结束标记并关闭文件
+ * @return 打开后的所有写入均成功时返回 true
+ */
+bool SLCWriter::close ()
+{
+    if (! m_file.isOpen ())
+    {
+        return false;
+    }
+
+    uchar *terminator (reserve (8));
+    if (terminator != nullptr)
+    {
+        writeFloat (terminator, m_lastZ);
+        writeUInt32 (terminator + 4, 0xFFFFFFFF);
+    }
+    flush ();
+    m_file.close ();
+    m_buffer.clear ();
+
+    const bool ok (m_ok);
+    m_ok = false;
+    return ok;
+}
+
+bool SLCWriter::isOpen () const
+{
+    return m_file.isOpen ();
+}
+
+int SLCWriter::layerCount () const
+{
+    return m_layerCount;
+}
+
+bool SLCWriter::flush ()
+{
+    SLCKIT_PROFILE_SCOPE ("SLCWriter::flush");
+
+    if (m_ok && m_used > 0)
+    {
+        m_ok = (m_file.write (m_buffer.constData (), m_used) == m_used);
+        SLCKIT_PROFILE_COUNT (BytesWritten, m_used);
+    }
+    m_used = 0;
+    return m_ok;
+}
+
+/**
+ * @brief 在缓冲区中预留 size 字节, 必要时先写出已有内容或扩大缓冲区
+ * @return 已有写入失败时返回 nullptr
+ */
+uchar *SLCWriter::reserve (qint64 size)
+{
+    if (m_used + size > m_buffer.size () && ! flush ())
+    {
+        return nullptr;
+    }
+    if (! m_ok)
+    {
+        return nullptr;
+    }
+    if (size > m_buffer.size ())
+    {
+        m_buffer.resize (int (size));
+    }
+
+    uchar *data (reinterpret_cast<uchar *> (m_buffer.data ()) + m_used);
+    m_used += size;
+    return data;
+}
+
+/**
+ * @brief 追加一个轮廓记录, 层高度写为 minZ, 各多边形的缺口数为 0
+ */
+bool SLCWriter::writeLayer (const Layer &layer)
+{
+    SLCKIT_PROFILE_SCOPE ("SLCWriter::writeLayer");
+
+    if (! m_file.isOpen ())
+    {
+        return false;
+    }
+
+    uchar *record (reserve (8));
+    if (record == nullptr)
+    {
+        return false;
+    }
+    m_lastZ = float (layer.height ());
+    writeFloat (record, m_lastZ);
+    writeUInt32 (record + 4, quint32 (layer.count ()));
+
+    for (const Polygon &polygon : layer)
+    {
+        const quint32 numberOfVertices (quint32 (polygon.count ()));
+        uchar *data (reserve (8 + qint64 (numberOfVertices) * 8));
+        if (data == nullptr)
+        {
+            return false;
+        }
+
+        writeUInt32 (data, numberOfVertices);
+        writeUInt32 (data + 4, 0);
+        data += 8;
+        SLCKIT_PROFILE_COUNT (Vertices, numberOfVertices);
+        for (const Point &point : polygon)
+        {
+            writeFloat (data, float (point.x ()));
+            writeFloat (data + 4, float (point.y ()));
+            data += 8;
+        }
+    }
+
+    ++m_layerCount;
+    SLCKIT_PROFILE_COUNT (Layers, 1);
+    SLCKIT_PROFILE_COUNT (Polygons, layer.count ());
+    return true;
+}
+
+/**
+ * @brief 与 writeLayer (const Layer &) 相同, 但直接写出紧凑存储的坐标
+ */
+bool SLCWriter::writeLayer (const CompactLayer &layer)
+{
+    SLCKIT_PROFILE_SCOPE ("SLCWriter::writeLayer");
+
+    if (! m_file.isOpen ())
+    {
+        return false;
+    }
+
+    uchar *record (reserve (8));
+    if (record == nullptr)
+    {
+        return false;
+    }
+    m_lastZ = float (layer.height ());
+    writeFloat (record, m_lastZ);
+    writeUInt32 (record + 4, quint32 (layer.count ()));
+
+    for (const CompactPolygon &polygon : layer)
+    {
+        const quint32 numberOfVertices (quint32 (polygon.count ()));
+        uchar *data (reserve (8 + qint64 (numberOfVertices) * 8));
+        if (data == nullptr)
+        {
+            return false;
+        }
+
+        writeUInt32 (data, numberOfVertices);
+        writeUInt32 (data + 4, 0);
+        data += 8;
+        SLCKIT_PROFILE_COUNT (Vertices, numberOfVertices);
+        const float *x (polygon.constXData ());
+        const float *y (polygon.constYData ());
+        for (quint32 verticeId = 0; verticeId < numberOfVertices; ++verticeId)
+        {
+            writeFloat (data, x [verticeId]);
+            writeFloat (data + 4, y [verticeId]);
+            data += 8;
+        }
+    }
+
+    ++m_layerCount;
+    SLCKIT_PROFILE_COUNT (Layers, 1);
+    SLCKIT_PROFILE_COUNT (Polygons, layer.count ());
+    return true;
+}
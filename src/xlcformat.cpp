@@ -0,0 +1,380 @@
+﻿#include "xlcformat.h"
+#include "model.h"
+#include "parallel.h"
+#include "profiling.h"
+
+#ifdef SLCKIT_USE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef SLCKIT_USE_ZSTD
+#include <zstd.h>
+#endif
+
+const XLCReader::LayerRecord xlcRecord (const Layer &layer)
+{
+    XLCReader::LayerRecord record;
+    record.height = layer.height ();
+    record.thickness = layer.thickness ();
+    record.polygonCount = quint32 (layer.count ());
+    for (const Polygon &polygon : layer)
+    {
+        if (record.vertexCount == 0 && ! polygon.isEmpty ())
+        {
+            record.z = polygon.first ().z ();
+        }
+        record.vertexCount += quint32 (polygon.count ());
+    }
+    record.length = xlcRawLength (record);
+    record.boundary = layer.boundary ();
+    return record;
+}
+
+void xlcWriteRecord (uchar *data, const XLCReader::LayerRecord &record)
+{
+    xlcWriteDouble (data, record.height);
+    xlcWriteDouble (data + 8, record.thickness);
+    xlcWriteDouble (data + 16, record.z);
+    xlcWriteInt64 (data + 24, record.offset);
+    xlcWriteInt64 (data + 32, record.length);
+    xlcWriteUInt32 (data + 40, record.polygonCount);
+    xlcWriteUInt32 (data + 44, record.vertexCount);
+    xlcWriteDouble (data + 48, record.boundary.minX ());
+    xlcWriteDouble (data + 56, record.boundary.minY ());
+    xlcWriteDouble (data + 64, record.boundary.maxX ());
+    xlcWriteDouble (data + 72, record.boundary.maxY ());
+}
+
+void xlcReadRecord (const uchar *data, XLCReader::LayerRecord &record)
+{
+    record.height = xlcReadDouble (data);
+    record.thickness = xlcReadDouble (data + 8);
+    record.z = xlcReadDouble (data + 16);
+    record.offset = xlcReadInt64 (data + 24);
+    record.length = xlcReadInt64 (data + 32);
+    record.polygonCount = xlcReadUInt32 (data + 40);
+    record.vertexCount = xlcReadUInt32 (data + 44);
+    record.boundary = Boundary ();
+    record.boundary.setMinX (xlcReadDouble (data + 48));
+    record.boundary.setMinY (xlcReadDouble (data + 56));
+    record.boundary.setMaxX (xlcReadDouble (data + 64));
+    record.boundary.setMaxY (xlcReadDouble (data + 72));
+    if (record.vertexCount > 0)
+    {
+        record.boundary.setMinZ (record.z);
+        record.boundary.setMaxZ (record.z);
+    }
+}
+
+void xlcEncodeLayer (const Layer &layer, const XLCReader::LayerRecord &record, uchar *data)
+{
+    uchar *table (data);
+    uchar *x (data + qint64 (record.polygonCount) * 8);
+    uchar *y (x + qint64 (record.vertexCount) * 4);
+    for (const Polygon &polygon : layer)
+    {
+        xlcWriteUInt32 (table, quint32 (polygon.count ()));
+        xlcWriteUInt32 (table + 4, quint32 (polygon.type ()));
+        table += 8;
+
+        for (const Point &point : polygon)
+        {
+            const float coordinates [2] = {float (point.x ()), float (point.y ())};
+            quint32 bits [2];
+            std::memcpy (bits, coordinates, sizeof (bits));
+            xlcWriteUInt32 (x, bits [0]);
+            xlcWriteUInt32 (y, bits [1]);
+            x += 4;
+            y += 4;
+        }
+    }
+}
+
+void xlcPackBlock (const uchar *raw, const XLCReader::LayerRecord &record, uchar *packed)
+{
+    const qint64 tableSize (qint64 (record.polygonCount) * 8);
+    const qint64 columnSize (qint64 (record.vertexCount) * 4);
+    std::memcpy (packed, raw, size_t (tableSize));
+
+    for (int column = 0; column < 2; ++column)
+    {
+        const uchar *values (raw + tableSize + column * columnSize);
+        uchar *planes (packed + tableSize + column * columnSize);
+        quint32 previous (0);
+        for (quint32 i = 0; i < record.vertexCount; ++i)
+        {
+            const quint32 value (xlcReadUInt32 (values + i * 4));
+            const quint32 delta (value - previous);
+            previous = value;
+            for (int plane = 0; plane < 4; ++plane)
+            {
+                planes [plane * record.vertexCount + i] = uchar (delta >> (8 * plane));
+            }
+        }
+    }
+}
+
+void xlcUnpackBlock (const uchar *packed, const XLCReader::LayerRecord &record, uchar *raw)
+{
+    const qint64 tableSize (qint64 (record.polygonCount) * 8);
+    const qint64 columnSize (qint64 (record.vertexCount) * 4);
+    std::memcpy (raw, packed, size_t (tableSize));
+
+    for (int column = 0; column < 2; ++column)
+    {
+        const uchar *planes (packed + tableSize + column * columnSize);
+        uchar *values (raw + tableSize + column * columnSize);
+        quint32 previous (0);
+        for (quint32 i = 0; i < record.vertexCount; ++i)
+        {
+            quint32 delta (0);
+            for (int plane = 0; plane < 4; ++plane)
+            {
+                delta |= quint32 (planes [plane * record.vertexCount + i]) << (8 * plane);
+            }
+            previous += delta;
+            xlcWriteUInt32 (values + i * 4, previous);
+        }
+    }
+}
+
+bool xlcIsSupported (quint32 compression)
+{
+    switch (compression)
+    {
+    case Model::NoCompression:
+        return true;
+#ifdef SLCKIT_USE_LZ4
+    case Model::LZ4Compression:
+        return true;
+#endif
+#ifdef SLCKIT_USE_ZSTD
+    case Model::ZstdCompression:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+bool xlcCompress (quint32 compression, const uchar *data, qint64 size, QByteArray &compressed)
+{
+    bool ok (false);
+    switch (compression)
+    {
+#ifdef SLCKIT_USE_LZ4
+    case Model::LZ4Compression:
+    {
+        compressed.resize (LZ4_compressBound (int (size)));
+        const int written (LZ4_compress_default (reinterpret_cast<const char *> (data),
+                                                 compressed.data (),
+                                                 int (size),
+                                                 compressed.size ()));
+        ok = (written > 0 || size == 0);
+        compressed.resize (ok ? written : 0);
+        break;
+    }
+#endif
+#ifdef SLCKIT_USE_ZSTD
+    case Model::ZstdCompression:
+    {
+        const size_t bound (ZSTD_compressBound (size_t (size)));
+        if (bound > size_t (xlcMaxBlockLength))
+        {
+            compressed.clear ();
+            break;
+        }
+        compressed.resize (int (bound));
+        const size_t written (ZSTD_compress (compressed.data (), size_t (compressed.size ()), data, size_t (size), 1));
+        ok = ! ZSTD_isError (written);
+        compressed.resize (ok ? int (written) : 0);
+        break;
+    }
+#endif
+    default:
+        Q_UNUSED (data);
+        Q_UNUSED (size);
+        compressed.clear ();
+        break;
+    }
+    return ok;
+}
+
+qint64 xlcMaxRawLength (quint32 compression, qint64 size)
+{
+    // LZ4 每个输入字节最多展开为 255 字节, zstd 的 RLE 块以 4 字节表示至多 128 KiB
+    qint64 ratio (1);
+    switch (compression)
+    {
+    case Model::LZ4Compression:
+        ratio = 256;
+        break;
+    case Model::ZstdCompression:
+        ratio = 32768;
+        break;
+    default:
+        break;
+    }
+    if (size < 0)
+    {
+        return 0;
+    }
+    return (size > xlcMaxBlockLength / ratio) ? xlcMaxBlockLength : size * ratio;
+}
+
+bool xlcDecompress (quint32 compression, const uchar *data, qint64 size, uchar *raw, qint64 rawSize)
+{
+    bool ok (false);
+    switch (compression)
+    {
+#ifdef SLCKIT_USE_LZ4
+    case Model::LZ4Compression:
+    {
+        const int read (LZ4_decompress_safe (reinterpret_cast<const char *> (data),
+                                             reinterpret_cast<char *> (raw),
+                                             int (size),
+                                             int (rawSize)));
+        ok = (read == rawSize);
+        break;
+    }
+#endif
+#ifdef SLCKIT_USE_ZSTD
+    case Model::ZstdCompression:
+    {
+        const size_t read (ZSTD_decompress (raw, size_t (rawSize), data, size_t (size)));
+        ok = (! ZSTD_isError (read) && read == size_t (rawSize));
+        break;
+    }
+#endif
+    default:
+        Q_UNUSED (data);
+        Q_UNUSED (size);
+        Q_UNUSED (raw);
+        Q_UNUSED (rawSize);
+        break;
+    }
+    return ok;
+}
+
+/**
+ * @brief 将 layer 编码为文件中存储的形式, 在调用线程中完成, 可并行调用
+ * @param record 返回目录项, length 为存储的字节数, offset 由调用者填写
+ * @param stored 返回存储的数据, 已补齐到 xlcAlignment
+ */
+static bool encodeBlock (const Layer &layer, quint32 compression, XLCReader::LayerRecord &record, QByteArray &stored)
+{
+    SLCKIT_PROFILE_SCOPE ("encodeBlock");
+
+    record = xlcRecord (layer);
+    if (record.length > xlcMaxBlockLength)
+    {
+        return false;
+    }
+    QByteArray block (int (record.length), '\0');
+    xlcEncodeLayer (layer, record, reinterpret_cast<uchar *> (block.data ()));
+
+    if (compression == Model::NoCompression)
+    {
+        stored.swap (block);
+    }
+    else
+    {
+        QByteArray packed;
+        packed.resize (block.size ());
+        xlcPackBlock (reinterpret_cast<const uchar *> (block.constData ()),
+                      record,
+                      reinterpret_cast<uchar *> (packed.data ()));
+        if (! xlcCompress (compression, reinterpret_cast<const uchar *> (packed.constData ()), packed.size (), stored))
+        {
+            return false;
+        }
+    }
+
+    record.length = stored.size ();
+    SLCKIT_PROFILE_COUNT (Layers, 1);
+    SLCKIT_PROFILE_COUNT (Polygons, record.polygonCount);
+    SLCKIT_PROFILE_COUNT (Vertices, record.vertexCount);
+    stored.append (QByteArray (int (xlcAligned (record.length) - record.length), '\0'));
+    return true;
+}
+
+bool writeXLC (QIODevice &device,
+               const QString &name,
+               const Layer *layers,
+               int count,
+               quint32 compression,
+               int threadCount,
+               const std::function<bool (int written, int count)> &progress)
+{
+    if (! xlcIsSupported (compression))
+    {
+        return false;
+    }
+
+    const QByteArray nameData (name.toUtf8 ());
+    const qint64 directoryOffset (xlcAligned (xlcHeaderSize + nameData.size ()));
+    const qint64 blockOffset (xlcAligned (directoryOffset + qint64 (count) * xlcRecordSize));
+    if (blockOffset > xlcMaxBlockLength)
+    {
+        return false;
+    }
+
+    // the directory is only known once every block is written, so the head is written twice
+    QByteArray head (int (blockOffset), '\0');
+    if (device.write (head) != head.size ())
+    {
+        return false;
+    }
+
+    // layers are encoded a batch at a time so that memory stays bounded by the batch, not the model
+    if (threadCount <= 0)
+    {
+        threadCount = QThread::idealThreadCount ();
+    }
+    const int batchSize (std::max (threadCount, 1) * 8);
+
+    QVector<XLCReader::LayerRecord> records (count);
+    QVector<QByteArray> blocks (std::min (batchSize, count));
+    QVector<char> encoded (blocks.count (), 0);
+    qint64 offset (blockOffset);
+    for (int first = 0; first < count; first += batchSize)
+    {
+        const int batch (std::min (batchSize, count - first));
+        XLCReader::LayerRecord *batchRecords (records.data () + first);
+        QByteArray *batchBlocks (blocks.data ());
+        char *flags (encoded.data ());
+        parallelFor (batch, threadCount, [=] (int index)
+        {
+            flags [index] = encodeBlock (layers [first + index], compression, batchRecords [index], batchBlocks [index]) ? 1 : 0;
+        });
+
+        for (int i = 0; i < batch; ++i)
+        {
+            if (! encoded.at (i) || device.write (blocks.at (i)) != blocks.at (i).size ())
+            {
+                return false;
+            }
+            batchRecords [i].offset = offset;
+            offset += blocks.at (i).size ();
+            SLCKIT_PROFILE_COUNT (BytesWritten, blocks.at (i).size ());
+        }
+
+        if (progress && ! progress (first + batch, count))
+        {
+            return false;
+        }
+    }
+
+    uchar *data (reinterpret_cast<uchar *> (head.data ()));
+    std::memcpy (data, xlcMagic, sizeof (xlcMagic));
+    xlcWriteUInt32 (data + 8, quint32 (count));
+    xlcWriteUInt32 (data + 12, quint32 (nameData.size ()));
+    xlcWriteInt64 (data + 16, directoryOffset);
+    xlcWriteUInt32 (data + 24, compression);
+    std::memcpy (data + xlcHeaderSize, nameData.constData (), size_t (nameData.size ()));
+    for (int i = 0; i < count; ++i)
+    {
+        xlcWriteRecord (data + directoryOffset + i * xlcRecordSize, records.at (i));
+    }
+    return (device.seek (0) && device.write (head) == head.size () && device.seek (offset));
+}
@@ -0,0 +1,152 @@
+﻿#ifndef XLCFORMAT_H
+#define XLCFORMAT_H
+
+#include "xlcreader.h"
+#include <QIODevice>
+#include <QtEndian>
+#include <cstring>
+#include <functional>
+
+// XLC v3 layout, every value is little-endian:
+//
+// header, xlcHeaderSize bytes
+//     char    magic [8]            "XLC v3.0"
+//     quint32 layerCount
+//     quint32 nameSize             bytes of the UTF-8 model name that follows the header
+//     qint64  directoryOffset      the name is padded to xlcAlignment
+//     quint32 compression          Model::XLCCompression of every layer block
+//     quint32 reserved
+// directory, xlcRecordSize bytes per layer in model order
+//     double  height, thickness, z
+//     qint64  offset, length       the layer block as stored, compressed or not
+//     quint32 polygonCount, vertexCount
+//     double  minX, minY, maxX, maxY
+// layer blocks, each starting on xlcAlignment
+//     polygonCount x {quint32 vertexCount, quint32 type}
+//     vertexCount x float x, then vertexCount x float y
+//
+// A compressed block is one independent LZ4 or zstd frame of the block above,
+// where each coordinate column is first delta-encoded on the float bit
+// patterns and split into four byte planes (see xlcPackBlock).
+
+static const char xlcMagic [8] = {'X', 'L', 'C', ' ', 'v', '3', '.', '0'};
+static const qint64 xlcHeaderSize = 32;
+static const qint64 xlcRecordSize = 80;
+static const qint64 xlcAlignment = 8;
+// a layer block, compressed or not, must fit into one QByteArray
+static const qint64 xlcMaxBlockLength = 0x7fff0000;
+
+static inline qint64 xlcAligned (qint64 offset)
+{
+    return (offset + xlcAlignment - 1) / xlcAlignment * xlcAlignment;
+}
+
+static inline quint32 xlcReadUInt32 (const uchar *data)
+{
+    return qFromLittleEndian<quint32> (data);
+}
+
+static inline qint64 xlcReadInt64 (const uchar *data)
+{
+    return qFromLittleEndian<qint64> (data);
+}
+
+static inline qreal xlcReadDouble (const uchar *data)
+{
+    quint64 bits (qFromLittleEndian<quint64> (data));
+    double value;
+    std::memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+
+static inline void xlcWriteUInt32 (uchar *data, quint32 value)
+{
+    qToLittleEndian<quint32> (value, data);
+}
+
+static inline void xlcWriteInt64 (uchar *data, qint64 value)
+{
+    qToLittleEndian<qint64> (value, data);
+}
+
+static inline void xlcWriteDouble (uchar *data, double value)
+{
+    quint64 bits;
+    std::memcpy (&bits, &value, sizeof (bits));
+    qToLittleEndian<quint64> (bits, data);
+}
+
+/**
+ * @brief 层数据块未压缩时的字节数
+ */
+static inline qint64 xlcRawLength (const XLCReader::LayerRecord &record)
+{
+    return qint64 (record.polygonCount) * 8 + qint64 (record.vertexCount) * 8;
+}
+
+/**
+ * @brief 求 layer 的目录项, offset 由调用者填写, length 为未压缩的长度
+ */
+const XLCReader::LayerRecord xlcRecord (const Layer &layer);
+
+void xlcWriteRecord (uchar *data, const XLCReader::LayerRecord &record);
+void xlcReadRecord (const uchar *data, XLCReader::LayerRecord &record);
+
+/**
+ * @brief 将 layer 编码为 record.length 字节的层数据块
+ */
+void xlcEncodeLayer (const Layer &layer, const XLCReader::LayerRecord &record, uchar *data);
+
+/**
+ * @brief 将未压缩的层数据块 raw 中的坐标列做差分并拆分为字节平面, 多边形表原样复制
+ *
+ * 相邻顶点坐标的位模式相差很小, 差分后高位字节多为 0 或 0xff, 拆分后集中在一起便于压缩.
+ * 差分按 quint32 取模进行, 无损可逆.
+ */
+void xlcPackBlock (const uchar *raw, const XLCReader::LayerRecord &record, uchar *packed);
+
+/**
+ * @brief xlcPackBlock 的逆变换
+ */
+void xlcUnpackBlock (const uchar *packed, const XLCReader::LayerRecord &record, uchar *raw);
+
+bool xlcIsSupported (quint32 compression);
+
+/**
+ * @brief 以 compression 压缩 size 字节的 data
+ * @return 不支持该压缩方式或压缩失败时返回 false
+ */
+bool xlcCompress (quint32 compression, const uchar *data, qint64 size, QByteArray &compressed);
+
+/**
+ * @brief 长度为 size 的压缩数据块解压后最多可能的字节数
+ *
+ * 由各压缩格式的最大压缩比决定, 且不超过 xlcMaxBlockLength. 目录中的未压缩长度超过它时文件已损坏.
+ */
+qint64 xlcMaxRawLength (quint32 compression, qint64 size);
+
+/**
+ * @brief 解压为恰好 rawSize 字节的数据
+ * @return 数据损坏或解压后长度不符时返回 false
+ */
+bool xlcDecompress (quint32 compression, const uchar *data, qint64 size, uchar *raw, qint64 rawSize);
+
+/**
+ * @brief 将 count 个层写为 XLC v3 文件
+ *
+ * 各层分批在 threadCount 个线程中编码压缩到各自的缓冲区, 再由调用线程按顺序写出,
+ * 每写完一批调用一次 progress. 层目录在所有层数据块写完后回填, device 须支持 seek.
+ * @param threadCount 线程数, 小于等于 0 时使用 QThread::idealThreadCount ()
+ * @param progress 参数为已写出的层数与总层数, 返回 false 时中止写入, 可为空
+ * @return 全部写入成功时返回 true, 不支持 compression, 被中止, 或文件头与层目录或某一层的数据块
+ *         超过 xlcMaxBlockLength 时返回 false
+ */
+bool writeXLC (QIODevice &device,
+               const QString &name,
+               const Layer *layers,
+               int count,
+               quint32 compression,
+               int threadCount,
+               const std::function<bool (int written, int count)> &progress);
+
+#endif // XLCFORMAT_H
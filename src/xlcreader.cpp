@@ -0,0 +1,457 @@
+﻿#include "xlcreader.h"
+#include "profiling.h"
+#include "xlcformat.h"
+
+static inline float readFloat (const uchar *data)
+{
+    quint32 bits (xlcReadUInt32 (data));
+    float value;
+    std::memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+
+/**
+ * @brief 复制 count 个 float, 小端主机上整块复制
+ */
+static inline void readFloats (const uchar *data, quint32 count, float *values)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    std::memcpy (values, data, size_t (count) * sizeof (float));
+#else
+    for (quint32 i = 0; i < count; ++i)
+    {
+        values [i] = readFloat (data + i * 4);
+    }
+#endif
+}
+
+XLCReader::XLCReader ()
+{}
+
+XLCReader::~XLCReader ()
+{
+    close ();
+}
+
+bool XLCReader::open (const QString &filename)
+{
+    close ();
+
+    bool ok (false);
+    do
+    {
+        if (filename.isEmpty ())
+        {
+            break;
+        }
+
+        m_file.setFileName (filename);
+        if (! m_file.open (QIODevice::ReadOnly))
+        {
+            break;
+        }
+
+        m_size = m_file.size ();
+        if (m_size < xlcHeaderSize)
+        {
+            break;
+        }
+
+        m_data = m_file.map (0, m_size);
+        if (m_data == nullptr)
+        {
+            break;
+        }
+
+        if (! readHeader ())
+        {
+            break;
+        }
+
+        ok = true;
+    }
+    while (false);
+
+    if (! ok)
+    {
+        close ();
+    }
+    return ok;
+}
+
+void XLCReader::close ()
+{
+    if (m_data != nullptr)
+    {
+        m_file.unmap (const_cast<uchar *> (m_data));
+        m_data = nullptr;
+    }
+    m_file.close ();
+
+    m_size = 0;
+    m_name.clear ();
+    m_compression = Model::NoCompression;
+    m_records.clear ();
+}
+
+bool XLCReader::isOpen () const
+{
+    return (m_data != nullptr);
+}
+
+const QString XLCReader::name () const
+{
+    return m_name;
+}
+
+Model::XLCCompression XLCReader::compression () const
+{
+    return Model::XLCCompression (m_compression);
+}
+
+int XLCReader::count () const
+{
+    return m_records.count ();
+}
+
+const QVector<XLCReader::LayerRecord> XLCReader::records () const
+{
+    return m_records;
+}
+
+/**
+ * @return 下标越界时返回空的目录项
+ */
+const XLCReader::LayerRecord XLCReader::record (int index) const
+{
+    return m_records.value (index);
+}
+
+/**
+ * @brief 校验文件头并读入层目录, 每个层数据块都须完整地位于文件内
+ *
+ * 压缩文件中各层的未压缩长度须在 xlcMaxRawLength 之内, 解压前按它分配缓冲区.
+ * @return 文件损坏或本库未启用文件所用的压缩方式时返回 false
+ */
+bool XLCReader::readHeader ()
+{
+    if (std::memcmp (m_data, xlcMagic, sizeof (xlcMagic)) != 0)
+    {
+        return false;
+    }
+
+    const quint32 layerCount (xlcReadUInt32 (m_data + 8));
+    const quint32 nameSize (xlcReadUInt32 (m_data + 12));
+    const qint64 directoryOffset (xlcReadInt64 (m_data + 16));
+    m_compression = xlcReadUInt32 (m_data + 24);
+    if (! xlcIsSupported (m_compression) ||
+        quint64 (nameSize) > quint64 (m_size - xlcHeaderSize) ||
+        directoryOffset < xlcHeaderSize + qint64 (nameSize) ||
+        directoryOffset > m_size ||
+        quint64 (layerCount) * xlcRecordSize > quint64 (m_size - directoryOffset))
+    {
+        return false;
+    }
+
+    m_name = QString::fromUtf8 (QByteArray (reinterpret_cast<const char *> (m_data + xlcHeaderSize), int (nameSize)));
+
+    m_records.resize (int (layerCount));
+    for (quint32 i = 0; i < layerCount; ++i)
+    {
+        LayerRecord &record (m_records [int (i)]);
+        xlcReadRecord (m_data + directoryOffset + i * xlcRecordSize, record);
+        if (record.offset < 0 || record.offset > m_size ||
+            record.length < 0 ||
+            record.length > m_size - record.offset ||
+            (m_compression == Model::NoCompression && record.length != xlcRawLength (record)) ||
+            (m_compression != Model::NoCompression && xlcRawLength (record) > xlcMaxRawLength (m_compression, record.length)))
+        {
+            m_records.clear ();
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 取第 index 层未压缩的数据块
+ *
+ * 未压缩的文件直接返回映射内存中的位置, 否则解压至 buffer 并还原坐标列.
+ * @return 解压失败时返回 nullptr
+ */
+const uchar *XLCReader::block (int index, QByteArray &buffer) const
+{
+    const LayerRecord &record (m_records.at (index));
+    if (m_compression == Model::NoCompression)
+    {
+        return m_data + record.offset;
+    }
+
+    const qint64 rawLength (xlcRawLength (record));
+    QByteArray packed;
+    packed.resize (int (rawLength));
+    buffer.resize (int (rawLength));
+    SLCKIT_PROFILE_COUNT (Allocations, 2);
+    if (packed.size () != rawLength ||
+        buffer.size () != rawLength ||
+        ! xlcDecompress (m_compression,
+                         m_data + record.offset,
+                         record.length,
+                         reinterpret_cast<uchar *> (packed.data ()),
+                         packed.size ()))
+    {
+        return nullptr;
+    }
+    xlcUnpackBlock (reinterpret_cast<const uchar *> (packed.constData ()), record, reinterpret_cast<uchar *> (buffer.data ()));
+    return reinterpret_cast<const uchar *> (buffer.constData ());
+}
+
+namespace
+{
+
+/**
+ * @brief decodeLayer 的解码目标, 写入 Layer
+ */
+class LayerTarget
+{
+public:
+    explicit LayerTarget (Layer &layer) : m_layer (layer) {}
+
+    bool resize (quint32 polygonCount)
+    {
+        m_layer.resize (int (polygonCount));
+        return true;
+    }
+
+    bool setPolygon (quint32 index, quint32 vertexCount, Polygon::PolygonType type, const uchar *x, const uchar *y, qreal z)
+    {
+        Polygon &polygon (m_layer [int (index)]);
+        polygon.resize (int (vertexCount));
+        Point *point (polygon.data ());
+        for (quint32 verticeId = 0; verticeId < vertexCount; ++verticeId)
+        {
+            point [verticeId].setValue (readFloat (x), readFloat (y), z);
+            x += 4;
+            y += 4;
+        }
+        polygon.setType (type);
+        return true;
+    }
+
+    bool finish (const XLCReader::LayerRecord &record)
+    {
+        m_layer.setHeight (record.height);
+        m_layer.setThickness (record.thickness);
+        return true;
+    }
+
+private:
+    Layer &m_layer;
+};
+
+/**
+ * @brief decodeLayer 的解码目标, 写入 CompactLayer, 坐标整块复制
+ */
+class CompactLayerTarget
+{
+public:
+    explicit CompactLayerTarget (CompactLayer &layer) : m_layer (layer) {}
+
+    bool resize (quint32 polygonCount)
+    {
+        m_layer.resize (int (polygonCount));
+        return true;
+    }
+
+    bool setPolygon (quint32 index, quint32 vertexCount, Polygon::PolygonType type, const uchar *x, const uchar *y, qreal z)
+    {
+        Q_UNUSED (z);
+        CompactPolygon &polygon (m_layer [int (index)]);
+        polygon.resize (int (vertexCount));
+        readFloats (x, vertexCount, polygon.xData ());
+        readFloats (y, vertexCount, polygon.yData ());
+        polygon.setType (type);
+        return true;
+    }
+
+    bool finish (const XLCReader::LayerRecord &record)
+    {
+        m_layer.setHeight (record.height);
+        m_layer.setThickness (record.thickness);
+        m_layer.setZ (record.z);
+        return true;
+    }
+
+private:
+    CompactLayer &m_layer;
+};
+
+/**
+ * @brief decodeLayer 的解码目标, 写入 PackedModel 中一层预先分配的区间, 数量须与区间相符
+ */
+class PackedLayerTarget
+{
+public:
+    PackedLayerTarget (PackedModel &model, int index) :
+        m_layer (model.layerData () [index]),
+        m_polygons (model.polygonData () + m_layer.firstPolygon),
+        m_points (model.pointData ()),
+        m_vertex (m_layer.firstVertex)
+    {}
+
+    bool resize (quint32 polygonCount)
+    {
+        return (qint64 (polygonCount) == m_layer.polygonCount);
+    }
+
+    bool setPolygon (quint32 index, quint32 vertexCount, Polygon::PolygonType type, const uchar *x, const uchar *y, qreal z)
+    {
+        if (qint64 (vertexCount) > m_layer.firstVertex + m_layer.vertexCount - m_vertex)
+        {
+            return false;
+        }
+
+        PackedModel::PolygonRange &polygon (m_polygons [index]);
+        polygon.firstVertex = m_vertex;
+        polygon.vertexCount = vertexCount;
+        polygon.type = type;
+        Point *point (m_points + m_vertex);
+        for (quint32 verticeId = 0; verticeId < vertexCount; ++verticeId)
+        {
+            point [verticeId].setValue (readFloat (x), readFloat (y), z);
+            x += 4;
+            y += 4;
+        }
+        m_vertex += vertexCount;
+        return true;
+    }
+
+    bool finish (const XLCReader::LayerRecord &record)
+    {
+        m_layer.height = record.height;
+        m_layer.thickness = record.thickness;
+        return (m_vertex == m_layer.firstVertex + m_layer.vertexCount);
+    }
+
+private:
+    PackedModel::LayerRange &m_layer;
+    PackedModel::PolygonRange *m_polygons;
+    Point *m_points;
+    qint64 m_vertex;
+};
+
+}
+
+/**
+ * @brief 按目录项 record 解码未压缩的层数据块 table, 各 readLayer 共用
+ *
+ * Target 依次收到 resize (多边形数), 每个多边形的 setPolygon (序号, 顶点数, 类型, x 列, y 列, z)
+ * 及 finish (目录项), 任一返回 false 时解码失败.
+ * @return 数据块与目录不符或与 Target 不符时返回 false
+ */
+template <class Target>
+static bool decodeLayer (const uchar *table, const XLCReader::LayerRecord &record, Target &target)
+{
+    const uchar *x (table + qint64 (record.polygonCount) * 8);
+    const uchar *y (x + qint64 (record.vertexCount) * 4);
+
+    if (! target.resize (record.polygonCount))
+    {
+        return false;
+    }
+
+    quint32 remaining (record.vertexCount);
+    for (quint32 boundaryId = 0; boundaryId < record.polygonCount; ++boundaryId)
+    {
+        quint32 numberOfVertices (xlcReadUInt32 (table));
+        quint32 type (xlcReadUInt32 (table + 4));
+        table += 8;
+
+        if (numberOfVertices > remaining || type > Polygon::Extra ||
+            ! target.setPolygon (boundaryId, numberOfVertices, Polygon::PolygonType (type), x, y, record.z))
+        {
+            return false;
+        }
+        remaining -= numberOfVertices;
+        x += qint64 (numberOfVertices) * 4;
+        y += qint64 (numberOfVertices) * 4;
+    }
+    if (remaining != 0 || ! target.finish (record))
+    {
+        return false;
+    }
+
+    SLCKIT_PROFILE_COUNT (BytesRead, record.length);
+    SLCKIT_PROFILE_COUNT (Layers, 1);
+    SLCKIT_PROFILE_COUNT (Polygons, record.polygonCount);
+    SLCKIT_PROFILE_COUNT (Vertices, record.vertexCount);
+    return true;
+}
+
+/**
+ * @brief 按目录直接解码第 index 层, 与文件中其它层无关
+ * @param layer 解码结果, 所有顶点的 z 坐标均为目录中记录的 z
+ * @return 下标越界或数据块与目录不符时返回 false
+ */
+bool XLCReader::readLayer (int index, Layer &layer) const
+{
+    SLCKIT_PROFILE_SCOPE ("XLCReader::readLayer");
+
+    if (m_data == nullptr || index < 0 || index >= m_records.count ())
+    {
+        return false;
+    }
+
+    QByteArray buffer;
+    const uchar *table (block (index, buffer));
+    LayerTarget target (layer);
+    return (table != nullptr && decodeLayer (table, m_records.at (index), target));
+}
+
+/**
+ * @brief 与 readLayer (int, Layer &) 相同, 但直接解码为紧凑存储, 坐标整块复制
+ */
+bool XLCReader::readLayer (int index, CompactLayer &layer) const
+{
+    SLCKIT_PROFILE_SCOPE ("XLCReader::readLayer");
+
+    if (m_data == nullptr || index < 0 || index >= m_records.count ())
+    {
+        return false;
+    }
+
+    QByteArray buffer;
+    const uchar *table (block (index, buffer));
+    CompactLayerTarget target (layer);
+    return (table != nullptr && decodeLayer (table, m_records.at (index), target));
+}
+
+/**
+ * @brief 将第 index 层解码到 model 第 index 层预先分配的区间中
+ *
+ * 该层的 firstPolygon, polygonCount, firstVertex 与 vertexCount 须已按目录填好,
+ * 函数填写层高, 层厚, 各多边形的区间与顶点, 顶点的 z 坐标均为目录中记录的 z.
+ * @return 下标越界, 数据块与目录不符或与预先分配的数量不符时返回 false
+ */
+bool XLCReader::readLayer (int index, PackedModel &model) const
+{
+    SLCKIT_PROFILE_SCOPE ("XLCReader::readLayer");
+
+    if (m_data == nullptr || index < 0 || index >= m_records.count () || index >= model.count ())
+    {
+        return false;
+    }
+
+    // checked before decompressing, the block is not needed when the counts differ
+    const LayerRecord &record (m_records.at (index));
+    const PackedModel::LayerRange &layer (model.layerData () [index]);
+    if (layer.polygonCount != qint64 (record.polygonCount) || layer.vertexCount != qint64 (record.vertexCount))
+    {
+        return false;
+    }
+
+    QByteArray buffer;
+    const uchar *table (block (index, buffer));
+    PackedLayerTarget target (model, index);
+    return (table != nullptr && decodeLayer (table, record, target));
+}
@@ -0,0 +1,205 @@
+﻿#include <QDir>
+#include <QFile>
+#include <benchmark/benchmark.h>
+#include "modelgenerator.h"
+#include "packedmodel.h"
+
+// Every input comes from ModelGenerator with a fixed seed, so two runs of any
+// build measure exactly the same geometry and their JSON output can be diffed.
+
+static const quint32 Seed = 20240601;
+
+static const ModelGenerator::Spec syntheticSpec (int layerCount, int polygonCount, int vertexCount)
+{
+    ModelGenerator::Spec spec;
+    spec.seed = Seed;
+    spec.layerCount = layerCount;
+    spec.partCount = polygonCount;
+    spec.vertexCount = vertexCount;
+    spec.holeCount = 0;
+    return spec;
+}
+
+static const Model syntheticModel (int layerCount, int polygonCount, int vertexCount)
+{
+    return ModelGenerator::generate (syntheticSpec (layerCount, polygonCount, vertexCount));
+}
+
+static const Layer syntheticLayer (int polygonCount, int vertexCount)
+{
+    return ModelGenerator::generateLayer (syntheticSpec (1, polygonCount, vertexCount), 0);
+}
+
+// file benchmarks use models of layerCount x FilePolygons x FileVertices
+static const int FilePolygons = 8;
+static const int FileVertices = 256;
+
+/**
+ * @brief 生成并返回临时目录中的合成模型文件, 每个进程只生成一次
+ */
+static const QString syntheticFile (const QString &suffix, int layerCount)
+{
+    static QVector<QString> written;
+    const QString filename (QDir::temp ().filePath (QStringLiteral ("benchSLCKit-%1.%2").arg (layerCount).arg (suffix)));
+    if (! written.contains (filename))
+    {
+        const Model model (syntheticModel (layerCount, FilePolygons, FileVertices));
+        if (suffix == QStringLiteral ("slc"))
+        {
+            model.saveSLC (filename);
+        }
+        else
+        {
+            model.saveXLC (filename);
+        }
+        written.append (filename);
+    }
+    return filename;
+}
+
+static void BM_ReadSLC (benchmark::State &state)
+{
+    const int layerCount (int (state.range (0)));
+    const Model::SLCReadMode mode (Model::SLCReadMode (state.range (1)));
+    const QString filename (syntheticFile (QStringLiteral ("slc"), layerCount));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize (Model::readSLC (filename, mode));
+    }
+    state.SetItemsProcessed (state.iterations () * layerCount * FilePolygons * (FileVertices + 1));
+}
+BENCHMARK (BM_ReadSLC)
+    ->ArgsProduct ({{16, 256, 2048}, {Model::StreamedRead, Model::MappedRead}})
+    ->Unit (benchmark::kMillisecond);
+
+static void BM_ReadPackedSLC (benchmark::State &state)
+{
+    const int layerCount (int (state.range (0)));
+    const QString filename (syntheticFile (QStringLiteral ("slc"), layerCount));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize (PackedModel::readSLC (filename));
+    }
+    state.SetItemsProcessed (state.iterations () * layerCount * FilePolygons * (FileVertices + 1));
+}
+BENCHMARK (BM_ReadPackedSLC)->Arg (16)->Arg (256)->Arg (2048)->Unit (benchmark::kMillisecond);
+
+static void BM_ReadXLC (benchmark::State &state)
+{
+    const int layerCount (int (state.range (0)));
+    const QString filename (syntheticFile (QStringLiteral ("xlc"), layerCount));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize (Model::readXLC (filename));
+    }
+    state.SetItemsProcessed (state.iterations () * layerCount * FilePolygons * (FileVertices + 1));
+}
+BENCHMARK (BM_ReadXLC)->Arg (16)->Arg (256)->Arg (2048)->Unit (benchmark::kMillisecond);
+
+static void BM_SaveXLC (benchmark::State &state)
+{
+    const int layerCount (int (state.range (0)));
+    const Model model (syntheticModel (layerCount, FilePolygons, FileVertices));
+    const QString filename (QDir::temp ().filePath (QStringLiteral ("benchSLCKit-save.xlc")));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize (model.saveXLC (filename));
+    }
+    QFile::remove (filename);
+    state.SetItemsProcessed (state.iterations () * layerCount * FilePolygons * (FileVertices + 1));
+}
+BENCHMARK (BM_SaveXLC)->Arg (16)->Arg (256)->Arg (2048)->Unit (benchmark::kMillisecond);
+
+static void BM_PolygonSimplify (benchmark::State &state)
+{
+    const int vertexCount (int (state.range (0)));
+    const Polygon::SimplifyMethod method (Polygon::SimplifyMethod (state.range (1)));
+    const Polygon polygon (syntheticLayer (1, vertexCount).first ());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize (polygon.simplified (1.0, method));
+    }
+    state.SetItemsProcessed (state.iterations () * polygon.count ());
+}
+BENCHMARK (BM_PolygonSimplify)
+    ->ArgsProduct ({{1 << 10, 1 << 14, 1 << 18}, {Polygon::DouglasPeucker, Polygon::Visvalingam}});
+
+static void BM_PolygonArea (benchmark::State &state)
+{
+    const int vertexCount (int (state.range (0)));
+    const Polygon polygon (syntheticLayer (1, vertexCount).first ());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize (polygon.area ());
+    }
+    state.SetItemsProcessed (state.iterations () * polygon.count ());
+}
+BENCHMARK (BM_PolygonArea)->Arg (1 << 10)->Arg (1 << 14)->Arg (1 << 18);
+
+static void BM_LayerBoundary (benchmark::State &state)
+{
+    const int polygonCount (int (state.range (0)));
+    const Layer layer (syntheticLayer (polygonCount, 256));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize (layer.boundary ());
+    }
+    state.SetItemsProcessed (state.iterations () * polygonCount * 257);
+}
+BENCHMARK (BM_LayerBoundary)->Arg (16)->Arg (256)->Arg (4096);
+
+static void BM_LayerOptimize (benchmark::State &state)
+{
+    const int polygonCount (int (state.range (0)));
+    const Layer source (syntheticLayer (polygonCount, 16));
+    for (auto _ : state)
+    {
+        Layer layer (source);
+        benchmark::DoNotOptimize (layer.optimize ());
+    }
+    state.SetItemsProcessed (state.iterations () * polygonCount);
+}
+BENCHMARK (BM_LayerOptimize)->Arg (64)->Arg (1024)->Arg (16384)->Unit (benchmark::kMicrosecond);
+
+static void BM_ModelMerge (benchmark::State &state)
+{
+    const int layerCount (int (state.range (0)));
+    // with half the thickness, every other layer of the second model matches one of the first
+    ModelGenerator::Spec spec (syntheticSpec (layerCount, 4, 32));
+    const Model first (ModelGenerator::generate (spec));
+    spec.seed = Seed + 1;
+    spec.thickness /= 2;
+    const Model second (ModelGenerator::generate (spec));
+    for (auto _ : state)
+    {
+        Model model (first);
+        model.merge (second);
+        benchmark::DoNotOptimize (model.count ());
+    }
+    state.SetItemsProcessed (state.iterations () * layerCount * 2);
+}
+BENCHMARK (BM_ModelMerge)->Arg (256)->Arg (4096)->Arg (32768)->Unit (benchmark::kMillisecond);
+
+static void BM_ModelLayerAtHeight (benchmark::State &state)
+{
+    const int layerCount (int (state.range (0)));
+    const Model model (syntheticModel (layerCount, 1, 8));
+    // query heights spread evenly over the model in a scattered order
+    const qreal top (model.constLast ().height ());
+    QVector<qreal> heights (1024);
+    for (int i = 0; i < heights.count (); ++i)
+    {
+        heights [i] = std::fmod (i * 0.6180339887 * top, top);
+    }
+
+    int index (0);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize (model.layerAtHeight (heights.at (index), Model::NearestHeight));
+        index = (index + 1) % heights.count ();
+    }
+    state.SetItemsProcessed (state.iterations ());
+}
+BENCHMARK (BM_ModelLayerAtHeight)->Arg (256)->Arg (4096)->Arg (65536);
+
+BENCHMARK_MAIN ();
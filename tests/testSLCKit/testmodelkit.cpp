@@ -1,9 +1,14 @@
 ﻿#include <QString>
 
 #include <QElapsedTimer>
+#include <QFile>
+#include <QtEndian>
+#include <cmath>
 #include <iostream>
 #include <time.h>
 #include "model.h"
+#include "packedmodel.h"
+#include "profiler.h"
 
 int _rand (int max)
 {
@@ -12,6 +17,111 @@ int _rand (int max)
     return std::rand () % (max - 1) + 1;
 }
 
+static int failures = 0;
+
+static void check (bool ok, const char *what)
+{
+    qDebug () << what << (ok ? "ok" : "FAILED");
+    if (! ok)
+    {
+        ++failures;
+    }
+}
+
+// 20 layers 0.1 apart, each with three closed regular polygons of different types and sizes
+static Model sampleModel ()
+{
+    Model model;
+    for (int layerIndex = 0; layerIndex < 20; ++layerIndex)
+    {
+        Layer layer;
+        layer.setHeight (0.1 * (layerIndex + 1));
+        layer.setThickness (0.1);
+        for (int polygonIndex = 0; polygonIndex < 3; ++polygonIndex)
+        {
+            Polygon polygon;
+            const int vertexCount = 3 + layerIndex + polygonIndex;
+            const double radius = 10.0 * (polygonIndex + 1) + layerIndex * 0.25;
+            for (int i = 0; i < vertexCount; ++i)
+            {
+                const double angle = i * 2 * PI / vertexCount;
+                polygon.append (Point (50 + radius * cos (angle), 40 + radius * sin (angle), layer.height ()));
+            }
+            polygon.close ();
+            polygon.setType (Polygon::PolygonType (polygonIndex));
+            layer.append (polygon);
+        }
+        model.append (layer);
+    }
+    model.sort ();
+    return model;
+}
+
+static qint64 vertexCount (const Model &model)
+{
+    qint64 count = 0;
+    for (const Layer &layer : model)
+    {
+        for (const Polygon &polygon : layer)
+        {
+            count += polygon.count ();
+        }
+    }
+    return count;
+}
+
+static bool sameHeights (const Model &a, const Model &b)
+{
+    if (a.count () != b.count ())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.count (); ++i)
+    {
+        if (a.at (i).height () != b.at (i).height ())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// same layers, heights and polygons with x/y within tolerance; SLC files keep no polygon types
+static bool sameGeometry (const Model &a, const Model &b, double tolerance, bool compareTypes)
+{
+    if (a.count () != b.count ())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.count (); ++i)
+    {
+        const Layer &layerA = a.at (i);
+        const Layer &layerB = b.at (i);
+        if (std::abs (layerA.height () - layerB.height ()) > tolerance || layerA.count () != layerB.count ())
+        {
+            return false;
+        }
+        for (int j = 0; j < layerA.count (); ++j)
+        {
+            const Polygon &polygonA = layerA.at (j);
+            const Polygon &polygonB = layerB.at (j);
+            if (polygonA.count () != polygonB.count () || (compareTypes && polygonA.type () != polygonB.type ()))
+            {
+                return false;
+            }
+            for (int k = 0; k < polygonA.count (); ++k)
+            {
+                if (std::abs (polygonA.at (k).x () - polygonB.at (k).x ()) > tolerance ||
+                    std::abs (polygonA.at (k).y () - polygonB.at (k).y ()) > tolerance)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 int main (/*int argc, char* argv[]*/)
 {
     double a1 = 10.003;
@@ -78,6 +188,7 @@ int main (/*int argc, char* argv[]*/)
     qDebug () << c4.area () << c4.centroid () << c4.center () << c4.dimension ();
     c4.close ();
     qDebug () << c4.area () << c4.centroid () << c4.center () << c4.dimension ();
+    qDebug () << c4.offsetted (-10) << c4.offsetted (5, Polygon::RoundJoin).first ().area ();
 
     Layer layer;
     layer.append(c2);
@@ -102,10 +213,38 @@ int main (/*int argc, char* argv[]*/)
     layer2.append (ca2);
 
     qDebug () << "area test:" << layer2.area ();
+    qDebug () << "boolean test:" << layer2.united (layer2.translated (Point (50, 50))).area ()
+             << layer2.intersected (layer2.translated (Point (50, 50))).area ();
+    qDebug () << "move test:" << (Layer (layer2).translated (Point (50, 50)).sorted (Layer::SupportInfillContour)
+                                   == layer2.translated (Point (50, 50)).sorted (Layer::SupportInfillContour));
 
     qDebug () << layer;
     qDebug () << layer.boundary ();
 
+    // 损坏的压缩 XLC 文件: 首层目录项的顶点数改为 0xffffffff, 应读取失败而不是越界写
+    Model xlcModel;
+    xlcModel.append (layer2);
+    for (Model::XLCCompression compression : {Model::LZ4Compression, Model::ZstdCompression})
+    {
+        const QString filename ("corrupt.xlc");
+        if (! Model::isCompressionSupported (compression) || ! xlcModel.saveXLC (filename, compression))
+        {
+            continue;
+        }
+        QFile file (filename);
+        if (file.open (QIODevice::ReadWrite))
+        {
+            // 文件头偏移 16 处为层目录的位置, 目录项偏移 44 处为顶点数
+            const QByteArray header (file.read (24));
+            const qint64 directoryOffset (qFromLittleEndian<qint64> (reinterpret_cast<const uchar *> (header.constData () + 16)));
+            file.seek (directoryOffset + 44);
+            file.write (QByteArray (4, char (0xff)));
+            file.close ();
+        }
+        qDebug () << "corrupt xlc test:" << compression << Model::readXLC (filename).isEmpty ();
+        QFile::remove (filename);
+    }
+
     Polygon c5;
     const unsigned int count = 8000000;
     {
@@ -178,6 +317,8 @@ int main (/*int argc, char* argv[]*/)
 
     qDebug () << redundant;
     qDebug () << redundant.simplified ();
+    qDebug () << redundant.simplified (1.0, Polygon::DouglasPeucker);
+    qDebug () << redundant.simplified (1.0, Polygon::Visvalingam);
 
     Layer l;
     Polygon p;
@@ -219,7 +360,77 @@ int main (/*int argc, char* argv[]*/)
     qDebug () << layerSort;
     qDebug () << layerSort.sorted (Layer::SortPattern::SupportInfillContour);
 
+    // height lookup, layers at 0.25, 0.5, ..., 5.0; both are exact in binary so the edges are exact too
+    Model stack;
+    for (int i = 1; i <= 20; ++i)
+    {
+        Layer layer;
+        layer.setHeight (0.25 * i);
+        stack.append (layer);
+    }
+    stack.sort ();
+    check (stack.indexOfHeight (1.0, Model::ExactHeight, 0.0) == 3 &&
+           stack.indexOfHeight (1.0625, Model::ExactHeight, 0.0) == -1 &&
+           stack.indexOfHeight (1.0, Model::FloorHeight, 0.0) == 3 &&
+           stack.indexOfHeight (1.0, Model::CeilHeight, 0.0) == 3,
+           "height tolerance 0 test:");
+    check (stack.indexOfHeight (1.0625, Model::ExactHeight, 0.0625) == 3 &&
+           stack.indexOfHeight (0.9375, Model::ExactHeight, 0.0625) == 3 &&
+           stack.indexOfHeight (1.09375, Model::ExactHeight, 0.0625) == -1 &&
+           stack.indexOfHeight (0.9375, Model::FloorHeight, 0.0625) == 3 &&
+           stack.indexOfHeight (1.0625, Model::CeilHeight, 0.0625) == 3,
+           "height tolerance edge test:");
+
+    // serial and threaded SLC reading
+    const Model sample = sampleModel ();
+    if (sample.saveSLC ("sample.slc"))
+    {
+        const Model streamed = Model::readSLC ("sample.slc", Model::StreamedRead);
+        const Model mapped = Model::readSLC ("sample.slc", Model::MappedRead);
+        const Model threaded = Model::readSLC ("sample.slc", 4);
+        check (streamed.count () == sample.count () && sameHeights (streamed, mapped) && sameHeights (streamed, threaded) &&
+               vertexCount (streamed) == vertexCount (mapped) && vertexCount (streamed) == vertexCount (threaded),
+               "threaded slc test:");
+        QFile::remove ("sample.slc");
+    }
+    else
+    {
+        check (false, "threaded slc test: save");
+    }
+
+    // SLC round trip: coordinates are stored as float32 millimetres
+    if (sample.saveSLC ("roundtrip.slc"))
+    {
+        check (sameGeometry (sample, Model::readSLC ("roundtrip.slc"), 1e-4, false), "slc round trip test:");
+        QFile::remove ("roundtrip.slc");
+    }
+    else
+    {
+        check (false, "slc round trip test: save");
+    }
+
+    // XLC round trip for every compression compiled in, through both readers
+    for (Model::XLCCompression compression : {Model::NoCompression, Model::LZ4Compression, Model::ZstdCompression})
+    {
+        if (! Model::isCompressionSupported (compression))
+        {
+            continue;
+        }
+        const QString filename ("roundtrip.xlc");
+        const bool saved = sample.saveXLC (filename, compression);
+        qDebug () << "xlc compression:" << compression;
+        check (saved && sameGeometry (sample, Model::readXLC (filename), 1e-4, true), "xlc round trip test:");
+        check (saved && sameGeometry (sample, PackedModel::readXLC (filename, 4).toModel (), 1e-4, true),
+               "packed xlc round trip test:");
+        QFile::remove (filename);
+    }
+
+    for (const Profiler::Stage &stage : Profiler::stages ())
+    {
+        qDebug () << "profile:" << stage.name << stage.calls << double (stage.totalTime) / 1e6 << "ms";
+    }
+
     qDebug () << "TEST FINISHED.";
     std::cin.get ();
-    return 0;
+    return (failures == 0) ? 0 : 1;
 }
@@ -0,0 +1,269 @@
+﻿#include "modelgenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+
+/**
+ * @brief 由 seed 与若干下标确定的随机数源, 只使用 std::mt19937 的原始输出, 不依赖标准分布的实现
+ */
+class Random
+{
+public:
+    Random (quint32 seed, quint32 a, quint32 b = 0) :
+        m_engine (seed ^ (a * 0x9e3779b9u) ^ (b * 0x85ebca6bu))
+    {
+        // the first outputs of a fresh mt19937 are poorly mixed for nearby seeds
+        m_engine.discard (16);
+    }
+
+    qreal uniform (qreal lower, qreal upper)
+    {
+        return lower + (upper - lower) * (m_engine () / 4294967296.0);
+    }
+
+private:
+    std::mt19937 m_engine;
+};
+
+/**
+ * @brief 零件在平台上的位置及不随层变化的形状参数
+ */
+class Part
+{
+public:
+    Part (const ModelGenerator::Spec &spec, int index)
+    {
+        Random random (spec.seed, quint32 (index), 0xffffffffu);
+        const int columns (int (std::ceil (std::sqrt (qreal (spec.partCount)))));
+        const qreal pitch (spec.partSize * 1.25);
+        x = (index % columns + 0.5) * pitch + random.uniform (-0.05, 0.05) * spec.partSize;
+        y = (index / columns + 0.5) * pitch + random.uniform (-0.05, 0.05) * spec.partSize;
+        radius = 0.5 * spec.partSize;
+
+        // three harmonics whose amplitudes add up to at most 0.3, so the outline stays star-shaped
+        for (int k = 0; k < 3; ++k)
+        {
+            amplitude [k] = random.uniform (0.0, 0.1);
+            phase [k] = random.uniform (0.0, 2.0 * PI);
+        }
+        twist = random.uniform (-0.05, 0.05);
+        taper = random.uniform (0.0, 0.3);
+        holePhase = random.uniform (0.0, 2.0 * PI);
+    }
+
+    qreal x;
+    qreal y;
+    qreal radius;
+    qreal amplitude [3];
+    qreal phase [3];
+    qreal twist;
+    qreal taper;
+    qreal holePhase;
+};
+
+const Polygon circle (qreal x, qreal y, qreal radius, int vertexCount, qreal z, bool clockwise)
+{
+    Polygon polygon;
+    polygon.reserve (vertexCount + 1);
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        const qreal angle ((clockwise ? -2.0 : 2.0) * PI * i / vertexCount);
+        polygon.append (Point (x + radius * std::cos (angle), y + radius * std::sin (angle), z));
+    }
+    polygon.close ();
+    return polygon;
+}
+
+const Polygon rectangle (qreal minX, qreal minY, qreal maxX, qreal maxY, qreal z, Polygon::PolygonType type)
+{
+    Polygon polygon;
+    polygon.append (Point (minX, minY, z));
+    polygon.append (Point (maxX, minY, z));
+    polygon.append (Point (maxX, maxY, z));
+    polygon.append (Point (minX, maxY, z));
+    polygon.close ();
+    polygon.setType (type);
+    return polygon;
+}
+
+/**
+ * @brief 拉伸体的截面: 带谐波起伏, 随高度扭转与收缩的外轮廓及均布的圆孔
+ * @param partZ 自零件底部起算的高度
+ */
+void appendExtruded (const ModelGenerator::Spec &spec, const Part &part, Random &random, qreal partZ, qreal z, Layer &layer)
+{
+    const qreal height (std::max (1, spec.layerCount - spec.supportLayerCount) * spec.thickness);
+    const qreal scale (1.0 - part.taper * partZ / height);
+    const qreal rotation (part.twist * partZ);
+    const int vertexCount (std::max (3, spec.vertexCount));
+
+    Polygon outline;
+    outline.reserve (vertexCount + 1);
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        const qreal angle (2.0 * PI * i / vertexCount);
+        qreal r (1.0);
+        for (int k = 0; k < 3; ++k)
+        {
+            r += part.amplitude [k] * std::cos ((k + 2) * angle + part.phase [k] + rotation);
+        }
+        r *= part.radius * scale * (1.0 + random.uniform (-0.002, 0.002));
+        outline.append (Point (part.x + r * std::cos (angle), part.y + r * std::sin (angle), z));
+    }
+    outline.close ();
+    layer.append (outline);
+
+    // the outline never comes closer than 0.49 radius to the centre, the holes stay within 0.47
+    const qreal inner (part.radius * scale);
+    const int holeVertexCount (std::max (8, vertexCount / 4));
+    if (spec.holeCount == 1)
+    {
+        layer.append (circle (part.x, part.y, 0.2 * inner, holeVertexCount, z, true));
+    }
+    else if (spec.holeCount > 1)
+    {
+        const qreal holeRadius (std::min (0.12, 0.3 * std::sin (PI / spec.holeCount)) * inner);
+        for (int i = 0; i < spec.holeCount; ++i)
+        {
+            const qreal angle (part.holePhase + rotation + 2.0 * PI * i / spec.holeCount);
+            layer.append (circle (part.x + 0.35 * inner * std::cos (angle),
+                                  part.y + 0.35 * inner * std::sin (angle),
+                                  holeRadius,
+                                  holeVertexCount,
+                                  z,
+                                  true));
+        }
+    }
+}
+
+/**
+ * @brief 立方点阵的截面: 节点处的竖杆, 以及每个单元高度处贯通各行各列的横梁
+ */
+void appendLattice (const ModelGenerator::Spec &spec, const Part &part, qreal partZ, qreal z, Layer &layer)
+{
+    const int cells (std::max (1, spec.latticeCells));
+    const qreal cellSize (2.0 * part.radius / cells);
+    const qreal strut (0.15 * cellSize);
+    const qreal minX (part.x - part.radius);
+    const qreal minY (part.y - part.radius);
+    const qreal maxX (part.x + part.radius);
+    const qreal maxY (part.y + part.radius);
+
+    QVector<Layer> struts;
+    for (int i = 0; i <= cells; ++i)
+    {
+        for (int j = 0; j <= cells; ++j)
+        {
+            const qreal x (minX + i * cellSize);
+            const qreal y (minY + j * cellSize);
+            Layer post;
+            post.append (rectangle (x - strut, y - strut, x + strut, y + strut, z, Polygon::Contour));
+            struts.append (post);
+        }
+    }
+
+    if (std::fmod (partZ, cellSize) < 2.0 * strut)
+    {
+        for (int i = 0; i <= cells; ++i)
+        {
+            const qreal offset (i * cellSize);
+            Layer row;
+            row.append (rectangle (minX - strut, minY + offset - strut, maxX + strut, minY + offset + strut, z, Polygon::Contour));
+            struts.append (row);
+            Layer column;
+            column.append (rectangle (minX + offset - strut, minY - strut, minX + offset + strut, maxY + strut, z, Polygon::Contour));
+            struts.append (column);
+        }
+        layer.append (Layer::united (struts));
+    }
+    else
+    {
+        for (const Layer &post : struts)
+        {
+            layer.append (post);
+        }
+    }
+}
+
+/**
+ * @brief 零件下方的支撑柱截面
+ */
+void appendSupport (const Part &part, qreal z, Layer &layer)
+{
+    const qreal pitch (2.0);
+    const qreal size (0.25);
+    const int steps (int (0.8 * part.radius / pitch));
+    for (int i = -steps; i <= steps; ++i)
+    {
+        for (int j = -steps; j <= steps; ++j)
+        {
+            const qreal x (part.x + i * pitch);
+            const qreal y (part.y + j * pitch);
+            layer.append (rectangle (x - size, y - size, x + size, y + size, z, Polygon::Support));
+        }
+    }
+}
+
+}
+
+/**
+ * @brief 生成整个模型, 各层依次由 generateLayer () 生成
+ */
+const Model ModelGenerator::generate(const Spec &spec)
+{
+    Model model;
+    model.setName (QStringLiteral ("synthetic"));
+    model.reserve (std::max (0, spec.layerCount));
+    for (int i = 0; i < spec.layerCount; ++i)
+    {
+        model.append (generateLayer (spec, i));
+    }
+    model.sort ();
+    return model;
+}
+
+/**
+ * @brief 生成第 index 层, 高度为 (index + 1) * thickness
+ *
+ * 前 supportLayerCount 层只含支撑, 之后为各零件的截面. ExtrudedShape 为带孔的拉伸体,
+ * LatticeShape 为立方点阵. infillInterval 大于 0 时按该间距生成扫描线填充, 相邻层方向相差 90 度.
+ */
+const Layer ModelGenerator::generateLayer(const Spec &spec, int index)
+{
+    const qreal z ((index + 1) * spec.thickness);
+    const qreal partZ ((index - spec.supportLayerCount) * spec.thickness);
+
+    Layer layer;
+    layer.setHeight (z);
+    layer.setThickness (spec.thickness);
+
+    for (int i = 0; i < spec.partCount; ++i)
+    {
+        const Part part (spec, i);
+        if (index < spec.supportLayerCount)
+        {
+            appendSupport (part, z, layer);
+        }
+        else if (spec.shape == LatticeShape)
+        {
+            appendLattice (spec, part, partZ, z, layer);
+        }
+        else
+        {
+            Random random (spec.seed, quint32 (i), quint32 (index));
+            appendExtruded (spec, part, random, partZ, z, layer);
+        }
+    }
+
+    if (index >= spec.supportLayerCount && spec.infillInterval > 0.0)
+    {
+        Layer::InfillSpec infill;
+        infill.interval = spec.infillInterval;
+        infill.angle = (index % 2 == 0) ? 0.0 : 90.0;
+        layer.fill (infill);
+    }
+    return layer;
+}
@@ -0,0 +1,44 @@
+﻿#ifndef MODELGENERATOR_H
+#define MODELGENERATOR_H
+
+#include "model.h"
+
+/**
+ * @brief 由种子确定的合成模型生成器, 用于基准测试与压力测试
+ *
+ * 随机数只取自 std::mt19937 的原始输出, 不经过实现相关的标准分布, 因此随机序列与标准库无关;
+ * 顶点坐标经由 <cmath> 的三角函数计算, 不同平台上末位可能不同.
+ * 每一层只由种子与层号决定, 可以逐层生成并流式写出任意大的模型.
+ */
+class ModelGenerator
+{
+public:
+    enum ShapeType
+    {
+        ExtrudedShape,
+        LatticeShape,
+    };
+
+    class Spec
+    {
+    public:
+        quint32 seed = 1;
+        int layerCount = 200;
+        qreal thickness = 0.05;
+
+        ShapeType shape = ExtrudedShape;
+        int partCount = 4;
+        qreal partSize = 20.0;
+        int vertexCount = 128;
+        int holeCount = 1;
+        int latticeCells = 4;
+
+        int supportLayerCount = 0;
+        qreal infillInterval = 0.0;
+    };
+
+    static const Model generate (const Spec &spec);
+    static const Layer generateLayer (const Spec &spec, int index);
+};
+
+#endif // MODELGENERATOR_H
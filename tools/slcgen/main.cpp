@@ -0,0 +1,126 @@
+﻿#include <QString>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "modelgenerator.h"
+#include "slcwriter.h"
+
+static void usage ()
+{
+    std::cerr << "usage: slcgen [options] <output.slc|output.xlc>\n"
+                 "  --seed <n>            random seed (1)\n"
+                 "  --layers <n>          layer count (200)\n"
+                 "  --thickness <mm>      layer thickness (0.05)\n"
+                 "  --shape <name>        extruded or lattice (extruded)\n"
+                 "  --parts <n>           parts on the plate (4)\n"
+                 "  --size <mm>           part size (20)\n"
+                 "  --vertices <n>        vertices per outline (128)\n"
+                 "  --holes <n>           holes per extruded part (1)\n"
+                 "  --cells <n>           lattice cells per side (4)\n"
+                 "  --support-layers <n>  leading support-only layers (0)\n"
+                 "  --infill <mm>         scan-line infill interval, 0 for none (0)\n"
+                 "  --compression <name>  XLC only: none, lz4 or zstd (none)\n";
+}
+
+int main (int argc, char *argv[])
+{
+    ModelGenerator::Spec spec;
+    Model::XLCCompression compression (Model::NoCompression);
+    QString filename;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *option (argv [i]);
+        if (option [0] != '-')
+        {
+            filename = QString::fromLocal8Bit (option);
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage ();
+            return 1;
+        }
+
+        const char *value (argv [++i]);
+        if (std::strcmp (option, "--seed") == 0)
+            spec.seed = quint32 (std::strtoul (value, nullptr, 10));
+        else if (std::strcmp (option, "--layers") == 0)
+            spec.layerCount = std::atoi (value);
+        else if (std::strcmp (option, "--thickness") == 0)
+            spec.thickness = std::atof (value);
+        else if (std::strcmp (option, "--shape") == 0 && std::strcmp (value, "extruded") == 0)
+            spec.shape = ModelGenerator::ExtrudedShape;
+        else if (std::strcmp (option, "--shape") == 0 && std::strcmp (value, "lattice") == 0)
+            spec.shape = ModelGenerator::LatticeShape;
+        else if (std::strcmp (option, "--parts") == 0)
+            spec.partCount = std::atoi (value);
+        else if (std::strcmp (option, "--size") == 0)
+            spec.partSize = std::atof (value);
+        else if (std::strcmp (option, "--vertices") == 0)
+            spec.vertexCount = std::atoi (value);
+        else if (std::strcmp (option, "--holes") == 0)
+            spec.holeCount = std::atoi (value);
+        else if (std::strcmp (option, "--cells") == 0)
+            spec.latticeCells = std::atoi (value);
+        else if (std::strcmp (option, "--support-layers") == 0)
+            spec.supportLayerCount = std::atoi (value);
+        else if (std::strcmp (option, "--infill") == 0)
+            spec.infillInterval = std::atof (value);
+        else if (std::strcmp (option, "--compression") == 0 && std::strcmp (value, "none") == 0)
+            compression = Model::NoCompression;
+        else if (std::strcmp (option, "--compression") == 0 && std::strcmp (value, "lz4") == 0)
+            compression = Model::LZ4Compression;
+        else if (std::strcmp (option, "--compression") == 0 && std::strcmp (value, "zstd") == 0)
+            compression = Model::ZstdCompression;
+        else
+        {
+            usage ();
+            return 1;
+        }
+    }
+
+    if (filename.isEmpty () || spec.layerCount <= 0 || spec.thickness <= 0.0)
+    {
+        usage ();
+        return 1;
+    }
+
+    bool ok (false);
+    if (filename.endsWith (QStringLiteral (".slc"), Qt::CaseInsensitive))
+    {
+        // SLC is streamed layer by layer, so the model never has to fit in memory
+        SLCWriter::Header header;
+        header.minZ = spec.thickness;
+        header.thickness = spec.thickness;
+
+        SLCWriter writer;
+        ok = writer.open (filename, header);
+        for (int i = 0; ok && i < spec.layerCount; ++i)
+        {
+            ok = writer.writeLayer (ModelGenerator::generateLayer (spec, i));
+        }
+        ok = writer.close () && ok;
+    }
+    else if (filename.endsWith (QStringLiteral (".xlc"), Qt::CaseInsensitive))
+    {
+        if (! Model::isCompressionSupported (compression))
+        {
+            std::cerr << "slcgen: compression not available in this build\n";
+            return 1;
+        }
+        ok = ModelGenerator::generate (spec).saveXLC (filename, compression);
+    }
+    else
+    {
+        usage ();
+        return 1;
+    }
+
+    if (! ok)
+    {
+        std::cerr << "slcgen: failed to write " << filename.toLocal8Bit ().constData () << "\n";
+        return 1;
+    }
+    return 0;
+}